@@ -1,26 +1,55 @@
+import ipaddress
 import socket
 
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import binary_sensor, sensor, since_, switch
+from esphome.components import binary_sensor, sensor, since_, switch, text_sensor
 from esphome.components.esp32 import add_idf_component
-from esphome.const import CONF_ADDRESS, CONF_ID, CONF_INTERVAL, CONF_NAME, CONF_TIMEOUT
+from esphome.const import (
+    CONF_ADDRESS,
+    CONF_ID,
+    CONF_INTERVAL,
+    CONF_NAME,
+    CONF_PAYLOAD,
+    CONF_PORT,
+    CONF_TIMEOUT,
+)
 from esphome.core import CORE
 
-DEPENDENCIES = ["asio_", "sensor", "binary_sensor"]
+DEPENDENCIES = ["asio_", "sensor", "binary_sensor", "text_sensor"]
 
 ping_ns = cg.esphome_ns.namespace("ping_")
 Ping = ping_ns.class_("Ping", cg.Component)
 Target = ping_ns.class_("Target", switch.Switch)
+Sweep = ping_ns.class_("Sweep")
+Probe = ping_ns.enum("Probe", is_class=True)
+PROBES = {
+    "icmp": Probe.ICMP,
+    "tcp": Probe.TCP,
+    "udp": Probe.UDP,
+}
 
 CONF_NONE = "none"
 CONF_SOME = "some"
 CONF_ALL = "all"
 CONF_COUNT = "count"
 CONF_TARGETS = "targets"
+CONF_INTERFACE = "interface"
+CONF_SOURCE = "source"
+CONF_RATE = "rate"
+CONF_BURST = "burst"
+CONF_SWEEPS = "sweeps"
+CONF_NETWORK = "network"
+CONF_BATCH = "batch"
+CONF_CHANGES = "changes"
 
 CONF_ABLE = "able"
 CONF_SINCE = "since"
+CONF_PROBE = "probe"
+CONF_TRACE = "trace"
+CONF_HOPS = "hops"
+CONF_HOLDOFF = "holdoff"
+CONF_TEXT = "text"
 
 
 def resolvable(address: str) -> str:
@@ -33,6 +62,33 @@ def resolvable(address: str) -> str:
             raise cv.Invalid(f"{address} not resolved: {e}")
 
 
+def network(value: object) -> ipaddress.IPv4Network:
+    value = cv.string_strict(value)
+    try:
+        network_ = ipaddress.IPv4Network(value, strict=False)
+    except ValueError as e:
+        raise cv.Invalid(f"{value} is not an IPv4 network: {e}")
+    if network_.prefixlen < 16:
+        raise cv.Invalid(f"{value} is too large (prefix must be at least 16)")
+    return network_
+
+
+def probe_port(config: dict) -> dict:
+    if config[CONF_PROBE] == "icmp":
+        if CONF_PORT in config or CONF_PAYLOAD in config:
+            raise cv.Invalid(
+                f"{CONF_PORT} and {CONF_PAYLOAD} require a tcp or udp {CONF_PROBE}"
+            )
+    else:
+        if CONF_PORT not in config:
+            raise cv.Invalid(
+                f"{config[CONF_PROBE]} {CONF_PROBE} requires a {CONF_PORT}"
+            )
+        if CONF_PAYLOAD in config and config[CONF_PROBE] != "udp":
+            raise cv.Invalid(f"{CONF_PAYLOAD} requires a udp {CONF_PROBE}")
+    return config
+
+
 MULTI_CONF = True
 
 CONFIG_SCHEMA = cv.All(
@@ -45,19 +101,64 @@ CONFIG_SCHEMA = cv.All(
             cv.Optional(CONF_ALL): binary_sensor.binary_sensor_schema(),
             cv.Optional(CONF_COUNT): sensor.sensor_schema(),
             cv.Optional(CONF_SINCE): since_.since_schema(),
+            # the path of all of our targets (and sweeps). targets on another path are those of another ping_.
+            cv.Optional(CONF_INTERFACE): cv.string_strict,
+            cv.Optional(CONF_SOURCE): cv.ipv4address,
+            cv.Optional(CONF_RATE, default=10.0): cv.positive_float,
+            cv.Optional(CONF_BURST, default=2): cv.positive_not_null_int,
             cv.Optional(CONF_TARGETS): cv.ensure_list(
-                switch.switch_schema(Target).extend(
+                cv.All(
+                    switch.switch_schema(Target).extend(
+                        {
+                            cv.GenerateID(): cv.declare_id(Target),
+                            cv.Required(CONF_ADDRESS): resolvable,
+                            cv.Optional(CONF_PROBE, default="icmp"): cv.enum(
+                                PROBES, lower=True
+                            ),
+                            cv.Optional(CONF_PORT): cv.port,
+                            cv.Optional(CONF_PAYLOAD): cv.string,
+                            cv.Optional(
+                                CONF_INTERVAL, default="16s"
+                            ): cv.positive_time_period_nanoseconds,
+                            cv.Optional(
+                                CONF_TIMEOUT, default="4s"
+                            ): cv.positive_time_period_nanoseconds,
+                            cv.Optional(CONF_ABLE): binary_sensor.binary_sensor_schema(),
+                            cv.Optional(CONF_SINCE): since_.since_schema(),
+                            cv.Optional(CONF_TRACE): cv.Schema(
+                                {
+                                    cv.Optional(CONF_HOPS, default=16): cv.int_range(
+                                        min=1, max=64
+                                    ),
+                                    cv.Optional(
+                                        CONF_HOLDOFF, default="5min"
+                                    ): cv.positive_time_period_nanoseconds,
+                                    cv.Optional(
+                                        CONF_TEXT
+                                    ): text_sensor.text_sensor_schema(),
+                                }
+                            ),
+                        }
+                    ),
+                    probe_port,
+                )
+            ),
+            cv.Optional(CONF_SWEEPS): cv.ensure_list(
+                cv.Schema(
                     {
-                        cv.GenerateID(): cv.declare_id(Target),
-                        cv.Required(CONF_ADDRESS): resolvable,
+                        cv.GenerateID(): cv.declare_id(Sweep),
+                        cv.Required(CONF_NETWORK): network,
                         cv.Optional(
-                            CONF_INTERVAL, default="16s"
+                            CONF_INTERVAL, default="5min"
                         ): cv.positive_time_period_nanoseconds,
                         cv.Optional(
                             CONF_TIMEOUT, default="4s"
                         ): cv.positive_time_period_nanoseconds,
-                        cv.Optional(CONF_ABLE): binary_sensor.binary_sensor_schema(),
-                        cv.Optional(CONF_SINCE): since_.since_schema(),
+                        # of our requests, which are also within the rate and burst of the ping_
+                        cv.Optional(CONF_RATE, default=50.0): cv.positive_float,
+                        cv.Optional(CONF_BATCH, default=8): cv.positive_not_null_int,
+                        cv.Optional(CONF_COUNT): sensor.sensor_schema(),
+                        cv.Optional(CONF_CHANGES): sensor.sensor_schema(),
                     }
                 )
             ),
@@ -69,6 +170,12 @@ CONFIG_SCHEMA = cv.All(
 async def to_code(config):
     ping = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(ping, config)
+    if CONF_INTERFACE in config:
+        cg.add(ping.set_interface(config[CONF_INTERFACE]))
+    if CONF_SOURCE in config:
+        cg.add(ping.set_source(str(config[CONF_SOURCE])))
+    cg.add(ping.set_rate(config[CONF_RATE]))
+    cg.add(ping.set_burst(config[CONF_BURST]))
     if CONF_NONE in config:
         cg.add(ping.set_none(await binary_sensor.new_binary_sensor(config[CONF_NONE])))
     if CONF_SOME in config:
@@ -86,6 +193,11 @@ async def to_code(config):
             target = await switch.new_switch(target_config)
             cg.add(target.set_ping(ping))
             cg.add(target.set_address(target_config[CONF_ADDRESS]))
+            cg.add(target.set_probe(target_config[CONF_PROBE]))
+            if CONF_PORT in target_config:
+                cg.add(target.set_port(target_config[CONF_PORT]))
+            if CONF_PAYLOAD in target_config:
+                cg.add(target.set_payload(target_config[CONF_PAYLOAD]))
             cg.add(target.set_timeout(target_config[CONF_TIMEOUT]))
             cg.add(target.set_interval(target_config[CONF_INTERVAL]))
             if CONF_ABLE in target_config:
@@ -98,3 +210,29 @@ async def to_code(config):
                 since_config = target_config[CONF_SINCE]
                 await since_.to_code(since_config)
                 cg.add(target.set_since(await cg.get_variable(since_config[CONF_ID])))
+            if CONF_TRACE in target_config:
+                trace_config = target_config[CONF_TRACE]
+                cg.add(target.set_trace_hops(trace_config[CONF_HOPS]))
+                cg.add(target.set_trace_holdoff(trace_config[CONF_HOLDOFF]))
+                if CONF_TEXT in trace_config:
+                    cg.add(
+                        target.set_trace_text(
+                            await text_sensor.new_text_sensor(trace_config[CONF_TEXT])
+                        )
+                    )
+    if CONF_SWEEPS in config:
+        for sweep_config in config[CONF_SWEEPS]:
+            sweep = cg.new_Pvariable(sweep_config[CONF_ID])
+            cg.add(sweep.set_ping(ping))
+            network_ = sweep_config[CONF_NETWORK]
+            cg.add(sweep.set_network(str(network_.network_address), network_.prefixlen))
+            cg.add(sweep.set_interval(sweep_config[CONF_INTERVAL]))
+            cg.add(sweep.set_timeout(sweep_config[CONF_TIMEOUT]))
+            cg.add(sweep.set_rate(sweep_config[CONF_RATE]))
+            cg.add(sweep.set_batch(sweep_config[CONF_BATCH]))
+            if CONF_COUNT in sweep_config:
+                cg.add(sweep.set_count(await sensor.new_sensor(sweep_config[CONF_COUNT])))
+            if CONF_CHANGES in sweep_config:
+                cg.add(
+                    sweep.set_changes(await sensor.new_sensor(sweep_config[CONF_CHANGES]))
+                )
@@ -13,9 +13,17 @@
 
 #include "ping.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
 #include <ranges>
 #include <span>
 
+#include <net/if.h>
+#include <sys/socket.h>
+
 // provide code generated from asio includes that follow below
 // visibility to our ASIO_NO_EXCEPTIONS asio::detail::throw_exception definition,
 // if called for, so that they can implicitly instantiate what they need.
@@ -29,6 +37,7 @@
 #include <asio/co_spawn.hpp>
 #include <asio/detached.hpp>
 #include <asio/redirect_error.hpp>
+#include <asio/ip/unicast.hpp>
 #include <asio/this_coro.hpp>
 #pragma GCC diagnostic pop
 
@@ -39,6 +48,9 @@ namespace {
 
 constexpr auto TAG{"ping_"};
 
+constexpr std::size_t IDS{std::size_t{1} << 16};  // ICMP ids that there are
+std::size_t ids{0};                               // next ICMP id to allocate, until IDS
+
 #pragma pack(push, 1)
 
 class Timestamp {
@@ -57,6 +69,7 @@ class Timestamp {
 
 constexpr auto IP_HEADER_SIZE_MIN{20};
 constexpr auto IP_HEADER_SIZE_MAX{60};
+constexpr auto ICMP_HEADER_SIZE{8};
 constexpr auto PADDING_SIZE{48};
 constexpr auto PACKET_SIZE{16 + PADDING_SIZE};
 
@@ -124,6 +137,32 @@ static_assert(PACKET_SIZE == sizeof(Packet), "Packet not packed properly");
 
 #pragma pack(pop)
 
+constexpr std::byte ECHO_REQUEST{8};
+constexpr std::byte TIME_EXCEEDED{11};
+
+// the sequence of a trace request has this bit set,
+// 7 bits of trace generation and 8 bits of TTL.
+// the sequence of other requests do not.
+constexpr std::uint16_t TRACE{0x8000};
+
+// return the payload of an IP datagram (empty if invalid)
+std::span<std::byte const> ip_payload(std::span<std::byte const> const datagram) {
+  if (datagram.size() < IP_HEADER_SIZE_MIN) {
+    return {};
+  }
+  size_t const ip_header_size{sizeof(std::uint32_t) * (static_cast<std::uint8_t>(datagram[0]) & 0x0F)};
+  if (ip_header_size < IP_HEADER_SIZE_MIN || ip_header_size > datagram.size()) {
+    ESP_LOGW(TAG, "received invalid IP header size (%zu bytes)", ip_header_size);
+    return {};
+  }
+  return datagram.subspan(ip_header_size);
+}
+
+// return the uint16_t at the start of from in host byte order
+std::uint16_t network_uint16(std::span<std::byte const> const from) {
+  return static_cast<std::uint16_t>(static_cast<std::uint16_t>(from[0]) << 8 | static_cast<std::uint16_t>(from[1]));
+}
+
 }  // namespace
 
 Target::Target() = default;
@@ -149,7 +188,18 @@ void Target::set_since(since_::Since *const since) {
   this->since_->update();
 }
 
+void Target::set_trace_hops(std::uint8_t const hops) {
+  this->trace_size_ = hops;
+  this->trace_hops_ = std::make_unique<Hop[]>(hops);
+}
+
 void Target::publish(bool const success, asio::steady_timer::time_point const &timepoint) {
+  // trace on transition from success to failure
+  if (!success && this->success_ && this->trace_hops_) {
+    this->trace();
+  }
+  // the first is news to the Ping, even of the failure that its targets are taken for until then
+  auto const first{this->unpublished_};
   this->unpublished_ = false;
   if (success) {
     ESP_LOGD(TAG, "%s ping success", this->tag_.c_str());
@@ -165,27 +215,57 @@ void Target::publish(bool const success, asio::steady_timer::time_point const &t
     if (this->since_)
       this->since_->set_when(timepoint);
     this->ping_->publish();
+  } else if (first) {
+    this->ping_->publish();
+  }
+}
+
+asio::steady_timer::time_point Target::next(asio::steady_timer::time_point const &after) const {
+  // computed from the epoch (not the last request) so timer latency does not accumulate as drift
+  auto const origin{this->ping_->epoch_ + this->phase_};
+  if (after < origin) {
+    return origin;
   }
+  return origin + ((after - origin) / this->interval_ + 1) * this->interval_;
 }
 
-void Target::setup(std::size_t const index, std::size_t const size) {
+void Target::setup(std::size_t const index) {
   this->timer_ = std::make_unique<asio::steady_timer>(this->ping_->io_);
+  if (this->trace_hops_) {
+    this->trace_timer_ = std::make_unique<asio::steady_timer>(this->ping_->io_);
+  }
+  this->id_ = static_cast<std::uint16_t>(this->ping_->id_ + index);
 
   this->write_state(true);
 
-  // periodically send ICMP echo requests to this->endpoint_
+  if (Probe::TCP == this->probe_) {
+    this->tcp_ = std::make_unique<asio::ip::tcp::socket>(this->ping_->io_);
+  } else if (Probe::UDP == this->probe_) {
+    this->udp_ = std::make_unique<asio::ip::udp::socket>(this->ping_->io_);
+    if (auto const ec{this->udp_connect()}) {
+      // we cannot be probed until we can connect, which each request will try again
+      ESP_LOGE(TAG, "%s udp connect error: %s", this->tag_.c_str(), ec.message().c_str());
+      this->publish(false, asio::steady_timer::clock_type::now());
+    }
+  }
+
+  // periodically send requests (ICMP echo, TCP connect or UDP) to this->endpoint_
   asio::co_spawn(
       this->ping_->io_,
-      [this, index, size]() -> asio::awaitable<void> {
-        auto const id{static_cast<std::uint16_t>(index)};
+      [this]() -> asio::awaitable<void> {
         std::uint16_t sequence{0};
-        // stagger start in an attempt to be out of phase with other targets
-        this->timer_->expires_after(this->interval_ * index / size);
+        // start in phase, out of phase with other targets
+        this->timer_->expires_at(this->next(asio::steady_timer::clock_type::now()));
         while (true) {
           {
             std::error_code ec;
+            this->waiting_ = true;
             co_await this->timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
-            if (ec == asio::error::operation_aborted) {
+            this->waiting_ = false;
+            if (ec == asio::error::operation_aborted && this->rephased_) {
+              this->rephased_ = false;
+              continue;  // re-armed in our new phase
+            } else if (ec == asio::error::operation_aborted) {
               ESP_LOGD(TAG, "%s abort: timer %s", this->tag_.c_str(), ec.message().c_str());
               break;
             } else if (ec) {
@@ -193,13 +273,29 @@ void Target::setup(std::size_t const index, std::size_t const size) {
               continue;
             }
           }
-          auto const request_timepoint{this->timer_->expiry()};
           if (this->state) {
             bool teardown{false};
             do {
-              Packet const packet{id, sequence++, request_timepoint};
-              ESP_LOGD(TAG, "%s sending ICMP echo request", this->tag_.c_str());
-              {
+              // the bucket shared with other targets may defer our request
+              auto const request_timepoint{this->ping_->bucket_.reserve(this->timer_->expiry())};
+              if (this->timer_->expiry() < request_timepoint) {
+                ESP_LOGV(TAG, "%s deferred by bucket", this->tag_.c_str());
+                this->timer_->expires_at(request_timepoint);
+                std::error_code ec;
+                co_await this->timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+                if (ec == asio::error::operation_aborted) {
+                  ESP_LOGD(TAG, "%s abort: timer %s", this->tag_.c_str(), ec.message().c_str());
+                  teardown = true;
+                  break;
+                } else if (ec) {
+                  ESP_LOGW(TAG, "%s timer error: %s", this->tag_.c_str(), ec.message().c_str());
+                  break;
+                }
+              }
+              auto const request_sequence{static_cast<std::uint16_t>(sequence++ % TRACE)};
+              if (Probe::ICMP == this->probe_) {
+                Packet const packet{this->id_, request_sequence, request_timepoint};
+                ESP_LOGD(TAG, "%s sending ICMP echo request", this->tag_.c_str());
                 std::error_code ec;
                 co_await this->ping_->socket_->async_send_to(asio::const_buffer(packet.data(), packet.size()),
                                                              this->endpoint_,
@@ -212,6 +308,8 @@ void Target::setup(std::size_t const index, std::size_t const size) {
                   ESP_LOGW(TAG, "%s send_to error: %s", this->tag_.c_str(), ec.message().c_str());
                   break;
                 }
+              } else if (!this->request(request_sequence, request_timepoint)) {
+                break;
               }
               this->timer_->expires_at(request_timepoint + this->timeout_);
               {
@@ -226,6 +324,7 @@ void Target::setup(std::size_t const index, std::size_t const size) {
                   break;
                 }
               }
+              this->cancel();
               if (this->reply_timepoint_ != request_timepoint) {
                 this->publish(false, request_timepoint);
               }
@@ -233,8 +332,8 @@ void Target::setup(std::size_t const index, std::size_t const size) {
             if (teardown)
               break;
           }
-          // strictly periodic from now on
-          this->timer_->expires_at(request_timepoint + this->interval_);
+          // strictly periodic in our (possibly rephased) phase from now on
+          this->timer_->expires_at(this->next(asio::steady_timer::clock_type::now()));
         }
         ESP_LOGD(TAG, "%s abort: timer reset", this->tag_.c_str());
         this->timer_.reset();
@@ -243,6 +342,104 @@ void Target::setup(std::size_t const index, std::size_t const size) {
       asio::detached);
 }
 
+bool Target::request(std::uint16_t const sequence, asio::steady_timer::time_point const &request_timepoint) {
+  // like an ICMP echo reply, completion of a TCP connect or UDP receive is handled asynchronously.
+  // any that have not completed by our timeout are cancelled.
+  std::error_code ec;
+  if (Probe::TCP == this->probe_) {
+    ESP_LOGD(TAG, "%s sending TCP connect request", this->tag_.c_str());
+    this->tcp_->open(asio::ip::tcp::v4(), ec);
+    if (ec) {
+      ESP_LOGW(TAG, "%s tcp open error: %s", this->tag_.c_str(), ec.message().c_str());
+      this->publish(false, request_timepoint);
+      return false;
+    }
+    this->tcp_->async_connect(asio::ip::tcp::endpoint(this->endpoint_.address(), this->port_),
+                              [this, sequence, request_timepoint](std::error_code const &ec_) {
+                                if (ec_ == asio::error::operation_aborted) {
+                                  return;  // timeout or teardown
+                                }
+                                std::error_code ignored;
+                                this->tcp_->close(ignored);
+                                if (ec_) {
+                                  ESP_LOGD(TAG, "%s tcp connect error: %s", this->tag_.c_str(), ec_.message().c_str());
+                                  return;
+                                }
+                                this->reply(this->endpoint_, sequence, request_timepoint);
+                              });
+  } else {
+    if (!this->udp_->is_open()) {
+      ec = this->udp_connect();
+      if (ec) {
+        ESP_LOGW(TAG, "%s udp connect error: %s", this->tag_.c_str(), ec.message().c_str());
+        this->publish(false, request_timepoint);
+        return false;
+      }
+    }
+    // a response to an earlier request, that came after we stopped waiting for it, is not one to this
+    std::size_t stale{0};
+    while (true) {
+      this->udp_->receive(asio::mutable_buffer(this->udp_buffer_.data(), this->udp_buffer_.size()), 0, ec);
+      if (ec == asio::error::would_block || ec == asio::error::try_again) {
+        break;
+      } else if (ec && ec != asio::error::connection_refused) {
+        ESP_LOGW(TAG, "%s udp drain error: %s", this->tag_.c_str(), ec.message().c_str());
+        break;
+      }
+      ++stale;
+    }
+    if (stale) {
+      ESP_LOGD(TAG, "%s drained %zu stale UDP responses", this->tag_.c_str(), stale);
+    }
+    ESP_LOGD(TAG, "%s sending UDP request", this->tag_.c_str());
+    this->udp_->send(asio::const_buffer(this->payload_.data(), this->payload_.size()), 0, ec);
+    if (ec) {
+      // such as connection refused, from the ICMP port unreachable of an earlier request
+      ESP_LOGW(TAG, "%s udp send error: %s", this->tag_.c_str(), ec.message().c_str());
+      this->publish(false, request_timepoint);
+      return false;
+    }
+    // any response is a reply
+    this->udp_->async_receive(asio::mutable_buffer(this->udp_buffer_.data(), this->udp_buffer_.size()),
+                              [this, sequence, request_timepoint](std::error_code const &ec_, std::size_t) {
+                                if (ec_ == asio::error::operation_aborted) {
+                                  return;  // timeout or teardown
+                                }
+                                if (ec_) {
+                                  // such as connection refused (ICMP port unreachable)
+                                  ESP_LOGD(TAG, "%s udp receive error: %s", this->tag_.c_str(), ec_.message().c_str());
+                                  return;
+                                }
+                                this->reply(this->endpoint_, sequence, request_timepoint);
+                              });
+  }
+  return true;
+}
+
+std::error_code Target::udp_connect() {
+  // without blocking, so that stale responses can be drained before each request
+  std::error_code ec;
+  this->udp_->connect(asio::ip::udp::endpoint(this->endpoint_.address(), this->port_), ec);
+  if (!ec) {
+    this->udp_->non_blocking(true, ec);
+  }
+  if (ec) {
+    std::error_code ignored;
+    this->udp_->close(ignored);
+  }
+  return ec;
+}
+
+void Target::cancel() {
+  std::error_code ec;
+  if (this->tcp_ && this->tcp_->is_open()) {
+    this->tcp_->close(ec);
+  }
+  if (this->udp_ && this->udp_->is_open()) {
+    this->udp_->cancel(ec);
+  }
+}
+
 void Target::reply(asio::ip::icmp::endpoint const &endpoint, uint16_t sequence,
                    asio::steady_timer::time_point const &timepoint) {
   // replies may come out of order, this->reply_timepoint_ must monotonically increase
@@ -256,29 +453,339 @@ void Target::reply(asio::ip::icmp::endpoint const &endpoint, uint16_t sequence,
   this->publish(true, timepoint);
 }
 
+void Target::trace() {
+  auto const now{asio::steady_timer::clock_type::now()};
+  if (this->tracing_ || !this->trace_timer_ || now < this->trace_timepoint_ + this->trace_holdoff_) {
+    ESP_LOGD(TAG, "%s trace held off", this->tag_.c_str());
+    return;
+  }
+  this->tracing_ = true;
+  this->trace_timepoint_ = now;
+  this->trace_reached_ = 0;
+  this->trace_generation_ = static_cast<std::uint8_t>((this->trace_generation_ + 1) % (TRACE >> 8));
+  std::fill_n(this->trace_hops_.get(), this->trace_size_, Hop{0, 0, UNREPLIED});
+  ESP_LOGI(TAG, "%s trace", this->tag_.c_str());
+
+  // send an echo request for each TTL, at the rate allowed by our Ping's bucket,
+  // until we have been reached, then give the stragglers a timeout to reply.
+  asio::co_spawn(
+      this->ping_->io_,
+      [this]() -> asio::awaitable<void> {
+        auto &socket{*this->ping_->socket_};
+        std::error_code ec;
+        asio::ip::unicast::hops restore{};
+        socket.get_option(restore, ec);
+        if (ec) {
+          ESP_LOGW(TAG, "%s trace get hops error: %s", this->tag_.c_str(), ec.message().c_str());
+          this->tracing_ = false;
+          co_return;
+        }
+        for (std::uint8_t ttl{1}; ttl <= this->trace_size_ && !this->trace_reached_; ++ttl) {
+          auto const request_timepoint{this->ping_->bucket_.reserve(asio::steady_timer::clock_type::now())};
+          this->trace_timer_->expires_at(request_timepoint);
+          co_await this->trace_timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+          if (ec == asio::error::operation_aborted) {
+            ESP_LOGD(TAG, "%s abort: trace timer %s", this->tag_.c_str(), ec.message().c_str());
+            co_return;  // teardown
+          } else if (ec) {
+            ESP_LOGW(TAG, "%s trace timer error: %s", this->tag_.c_str(), ec.message().c_str());
+            break;
+          }
+          auto const sequence{static_cast<std::uint16_t>(TRACE | this->trace_generation_ << 8 | ttl)};
+          Packet const packet{this->id_, sequence, request_timepoint};
+          // our socket is shared, so restore its TTL before anyone else can use it (do not co_await)
+          socket.set_option(asio::ip::unicast::hops(ttl), ec);
+          if (!ec) {
+            this->trace_hops_[ttl - 1u].sent = static_cast<std::uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(asio::steady_timer::clock_type::now() -
+                                                                      this->trace_timepoint_)
+                    .count());
+            socket.send_to(asio::const_buffer(packet.data(), packet.size()), this->endpoint_, 0, ec);
+            std::error_code restore_ec;
+            socket.set_option(restore, restore_ec);
+          }
+          if (ec) {
+            ESP_LOGW(TAG, "%s trace send_to error: %s", this->tag_.c_str(), ec.message().c_str());
+            break;
+          }
+        }
+        this->trace_timer_->expires_after(this->timeout_);
+        co_await this->trace_timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        if (ec == asio::error::operation_aborted) {
+          ESP_LOGD(TAG, "%s abort: trace timer %s", this->tag_.c_str(), ec.message().c_str());
+          co_return;  // teardown
+        } else if (ec) {
+          ESP_LOGW(TAG, "%s trace timer error: %s", this->tag_.c_str(), ec.message().c_str());
+        }
+        this->tracing_ = false;
+        this->trace_publish();
+        co_return;
+      },
+      asio::detached);
+}
+
+void Target::trace_reply(asio::ip::address_v4 const &address, std::uint16_t const sequence, bool const reached,
+                         asio::steady_timer::time_point const &timepoint) {
+  std::uint8_t const ttl{static_cast<std::uint8_t>(sequence)};
+  if (!this->tracing_ || this->trace_generation_ != ((sequence & ~TRACE) >> 8) || !ttl || ttl > this->trace_size_) {
+    ESP_LOGV(TAG, "%s stale trace reply", this->tag_.c_str());
+    return;
+  }
+  auto &hop{this->trace_hops_[ttl - 1u]};
+  if (UNREPLIED != hop.rtt) {
+    return;  // duplicate
+  }
+  hop.address = address.to_uint();
+  hop.rtt = static_cast<std::uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(timepoint - this->trace_timepoint_).count()) -
+            hop.sent;
+  if (reached && (!this->trace_reached_ || ttl < this->trace_reached_)) {
+    this->trace_reached_ = ttl;
+  }
+}
+
+void Target::trace_publish() {
+  // a hop that did not reply is shown as *
+  std::uint8_t const size{this->trace_reached_ ? this->trace_reached_ : this->trace_size_};
+  std::string text{};
+  for (std::uint8_t ttl{1}; ttl <= size; ++ttl) {
+    auto const &hop{this->trace_hops_[ttl - 1u]};
+    if (UNREPLIED == hop.rtt) {
+      ESP_LOGI(TAG, "%s trace %2u *", this->tag_.c_str(), ttl);
+      text += "*";
+    } else {
+      auto const address{asio::ip::address_v4(hop.address).to_string()};
+      auto const rtt{static_cast<float>(hop.rtt) / 1000};
+      ESP_LOGI(TAG, "%s trace %2u %s %.1f ms", this->tag_.c_str(), ttl, address.c_str(), rtt);
+      text += address + ' ' + std::to_string(static_cast<unsigned>(std::round(rtt))) + "ms";
+    }
+    if (ttl < size) {
+      text += " > ";
+    }
+  }
+  if (!this->trace_reached_) {
+    ESP_LOGI(TAG, "%s trace did not reach target", this->tag_.c_str());
+  }
+  if (this->trace_text_) {
+    this->trace_text_->publish_state(text);
+  }
+}
+
 void Target::write_state(bool const state_) {
   ESP_LOGD(TAG, "%s ping %s", this->tag_.c_str(), state_ ? "start" : "stop");
   this->publish_state(state_);
+  this->ping_->rephase();
   this->ping_->publish();
 }
 
+void Bucket::set_rate(float const rate) {
+  this->emission_ = 0 < rate ? std::chrono::duration_cast<asio::steady_timer::duration>(
+                                   std::chrono::duration<float>(1 / rate))
+                             : asio::steady_timer::duration::zero();
+  this->tolerance_ = this->emission_ * static_cast<asio::steady_timer::duration::rep>(this->burst_ - 1);
+}
+
+void Bucket::set_burst(std::size_t const burst) {
+  this->burst_ = std::max(burst, std::size_t{1});
+  this->tolerance_ = this->emission_ * static_cast<asio::steady_timer::duration::rep>(this->burst_ - 1);
+}
+
+float Bucket::get_rate() const {
+  return this->emission_.count() ? 1 / std::chrono::duration<float>(this->emission_).count() : 0;
+}
+
+asio::steady_timer::time_point Bucket::reserve(asio::steady_timer::time_point const timepoint) {
+  if (!this->emission_.count()) {
+    return timepoint;  // unlimited
+  }
+  // a probe conforms if it is not earlier than our tolerance before its theoretical arrival time.
+  // one that would not is deferred until it would.
+  auto const conforming{std::max(timepoint, this->arrival_ - this->tolerance_)};
+  this->arrival_ = std::max(this->arrival_, conforming) + this->emission_;
+  return conforming;
+}
+
+Sweep::Sweep() = default;
+
+void Sweep::set_ping(Ping *const ping) {
+  this->ping_ = ping;
+  ping->add(this);
+}
+
+void Sweep::set_network(esphome::network::IPAddress const address, std::uint8_t const prefix) {
+  // asio::ip::address_v4 takes address in host byte order!?
+  auto const mask{prefix ? ~std::uint32_t{0} << (32 - prefix) : 0};
+  this->network_ = ntohl(static_cast<ip_addr_t>(address).u_addr.ip4.addr) & mask;
+  auto const size{~mask + 1};  // of network in addresses
+  // exclude network and broadcast addresses unless there are no others
+  this->first_ = 2 < size ? 1 : 0;
+  this->last_ = 2 < size ? size - 2 : size - 1;
+  this->live_.assign((size + 31) / 32, 0);
+  this->seen_.assign(this->live_.size(), 0);
+  this->tag_ = "sweep " + asio::ip::address_v4(this->network_).to_string() + '/' + std::to_string(prefix);
+}
+
+void Sweep::set_count(sensor::Sensor *const count) {
+  this->count_ = count;
+  this->count_->publish_state(0);
+}
+
+void Sweep::set_changes(sensor::Sensor *const changes) {
+  this->changes_ = changes;
+  this->changes_->publish_state(0);
+}
+
+void Sweep::setup(std::size_t const index) {
+  this->timer_ = std::make_unique<asio::steady_timer>(this->ping_->io_);
+  this->id_ = static_cast<std::uint16_t>(this->ping_->id_ + index);
+
+  // periodically send an ICMP echo request to each host in network_
+  asio::co_spawn(
+      this->ping_->io_,
+      [this]() -> asio::awaitable<void> {
+        auto &socket{*this->ping_->socket_};
+        std::error_code ec;
+        this->timer_->expires_at(asio::steady_timer::clock_type::now());
+        while (true) {
+          auto const sweep_timepoint{this->timer_->expiry()};
+          ESP_LOGD(TAG, "%s start", this->tag_.c_str());
+          std::ranges::fill(this->seen_, 0);
+          auto offset{this->first_};
+          while (offset <= this->last_) {
+            // reserve a token for each request in a batch, from our bucket and that of the Ping (which our
+            // requests share with its targets), wait until they are all available, then send the batch back to back.
+            // a batch is no larger than the burst of either.
+            auto const batch_timepoint{asio::steady_timer::clock_type::now()};
+            auto request_timepoint{batch_timepoint};
+            auto const batch{std::min(this->bucket_.get_burst(), this->ping_->bucket_.get_burst())};
+            std::uint32_t end{offset};
+            for (std::size_t i{0}; i < batch && end <= this->last_; ++i, ++end) {
+              auto const ours{this->bucket_.reserve(batch_timepoint)};
+              request_timepoint = std::max({request_timepoint, ours, this->ping_->bucket_.reserve(batch_timepoint)});
+            }
+            if (batch_timepoint < request_timepoint) {
+              this->timer_->expires_at(request_timepoint);
+              co_await this->timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+              if (ec == asio::error::operation_aborted) {
+                ESP_LOGD(TAG, "%s abort: timer %s", this->tag_.c_str(), ec.message().c_str());
+                co_return;  // teardown
+              }
+            }
+            for (; offset < end; ++offset) {
+              ESP_LOGV(TAG, "%s %s sending ICMP echo request", this->tag_.c_str(),
+                       asio::ip::address_v4(this->network_ + offset).to_string().c_str());
+              Packet const packet{this->id_, static_cast<std::uint16_t>(offset), request_timepoint};
+              socket.send_to(asio::const_buffer(packet.data(), packet.size()),
+                             asio::ip::icmp::endpoint(asio::ip::address_v4(this->network_ + offset), 0), 0, ec);
+              if (ec) {
+                ESP_LOGV(TAG, "%s send_to %s error: %s", this->tag_.c_str(),
+                         asio::ip::address_v4(this->network_ + offset).to_string().c_str(), ec.message().c_str());
+              }
+            }
+          }
+          // give the stragglers a timeout to reply
+          this->timer_->expires_after(this->timeout_);
+          co_await this->timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+          if (ec == asio::error::operation_aborted) {
+            ESP_LOGD(TAG, "%s abort: timer %s", this->tag_.c_str(), ec.message().c_str());
+            co_return;  // teardown
+          }
+          this->publish();
+          this->timer_->expires_at(std::max(sweep_timepoint + this->interval_, asio::steady_timer::clock_type::now()));
+          co_await this->timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+          if (ec == asio::error::operation_aborted) {
+            ESP_LOGD(TAG, "%s abort: timer %s", this->tag_.c_str(), ec.message().c_str());
+            co_return;  // teardown
+          }
+        }
+      },
+      asio::detached);
+}
+
+void Sweep::reply(asio::ip::address_v4 const &address, std::uint16_t const sequence) {
+  auto const offset{address.to_uint() - this->network_};
+  if (offset != std::uint32_t{sequence} || offset < this->first_ || offset > this->last_) {
+    ESP_LOGV(TAG, "%s received reply from %s", this->tag_.c_str(), address.to_string().c_str());
+    return;
+  }
+  this->seen_[offset / 32] |= std::uint32_t{1} << (offset % 32);
+}
+
+void Sweep::publish() {
+  std::size_t count{0};
+  std::size_t changes{0};
+  for (std::size_t i{0}; i < this->seen_.size(); ++i) {
+    count += static_cast<std::size_t>(std::popcount(this->seen_[i]));
+    if (!this->swept_) {
+      continue;  // the first sweep has nothing to change from
+    }
+    auto changed{this->live_[i] ^ this->seen_[i]};
+    changes += static_cast<std::size_t>(std::popcount(changed));
+    while (changed) {
+      auto const bit{static_cast<std::uint32_t>(std::countr_zero(changed))};
+      changed &= changed - 1;
+      auto const offset{static_cast<std::uint32_t>(i * 32) + bit};
+      ESP_LOGD(TAG, "%s %s %s", this->tag_.c_str(), asio::ip::address_v4(this->network_ + offset).to_string().c_str(),
+               this->seen_[i] >> bit & 1 ? "up" : "down");
+    }
+  }
+  std::swap(this->live_, this->seen_);
+  if (!this->swept_) {
+    this->swept_ = true;
+    ESP_LOGI(TAG, "%s live %zu", this->tag_.c_str(), count);
+    if (this->count_)
+      this->count_->publish_state(static_cast<float>(count));
+    return;
+  }
+  ESP_LOGI(TAG, "%s live %zu changes %zu", this->tag_.c_str(), count, changes);
+  if (this->count_)
+    this->count_->publish_state(static_cast<float>(count));
+  if (this->changes_)
+    this->changes_->publish_state(static_cast<float>(changes));
+}
+
 Ping::Ping() {}
 
 void Ping::add(Target *const target) { this->targets_.push_back(target); }
+void Ping::add(Sweep *const sweep) { this->sweeps_.push_back(sweep); }
+
+void Ping::set_source(esphome::network::IPAddress const source) {
+  // asio::ip::address_v4 takes address in host byte order!?
+  this->source_.emplace(ntohl(static_cast<ip_addr_t>(source).u_addr.ip4.addr));
+}
 
 void Ping::dump_config() {
   ESP_LOGCONFIG(TAG, "ping:");
   LOG_BINARY_SENSOR(TAG, "all", this->all_);
   LOG_BINARY_SENSOR(TAG, "none", this->none_);
+  if (!this->interface_.empty())
+    ESP_LOGCONFIG(TAG, "interface: %s", this->interface_.c_str());
+  if (this->source_)
+    ESP_LOGCONFIG(TAG, "source: %s", this->source_->to_string().c_str());
+  ESP_LOGCONFIG(TAG, "rate: %.1f /s", this->bucket_.get_rate());
+  ESP_LOGCONFIG(TAG, "burst: %zu", this->bucket_.get_burst());
   for (auto const *const target : this->targets_) {
     ESP_LOGCONFIG(TAG, "target '%s':", target->get_name());
     ESP_LOGCONFIG(TAG, "address: %s", target->endpoint_.address().to_string().c_str());
+    if (Probe::ICMP != target->probe_)
+      ESP_LOGCONFIG(TAG, "probe: %s port %u", Probe::TCP == target->probe_ ? "tcp" : "udp", target->port_);
     ESP_LOGCONFIG(TAG, "timeout: %d ms", target->timeout_);
     ESP_LOGCONFIG(TAG, "interval: %d ms", target->interval_);
     if (target->able_)
       LOG_BINARY_SENSOR(TAG, "able", target->able_);
     if (target->since_)
       LOG_SENSOR(TAG, "since", target->since_);
+    if (target->trace_hops_)
+      ESP_LOGCONFIG(TAG, "trace hops: %u", target->trace_size_);
+  }
+  for (auto const *const sweep : this->sweeps_) {
+    ESP_LOGCONFIG(TAG, "%s:", sweep->tag_.c_str());
+    ESP_LOGCONFIG(TAG, "rate: %.1f /s", sweep->bucket_.get_rate());
+    ESP_LOGCONFIG(TAG, "batch: %zu", sweep->bucket_.get_burst());
+    if (sweep->count_)
+      LOG_SENSOR(TAG, "count", sweep->count_);
+    if (sweep->changes_)
+      LOG_SENSOR(TAG, "changes", sweep->changes_);
   }
 }
 
@@ -287,6 +794,17 @@ float Ping::get_setup_priority() const { return esphome::setup_priority::AFTER_C
 void Ping::setup() {
   ESP_LOGD(TAG, "setup");
 
+  // allocate an ICMP id for each of our targets and sweeps, all of which are distinct from any other's.
+  // a block that wrapped around would share ids with the first Ping's, whose replies we would take as ours.
+  auto const count{this->targets_.size() + this->sweeps_.size()};
+  if (IDS - ids < count) {
+    ESP_LOGE(TAG, "%zu ICMP ids needed, %zu left", count, IDS - ids);
+    this->mark_failed();
+    return;
+  }
+  this->id_ = static_cast<std::uint16_t>(ids);
+  ids += count;
+
   // we must delay socket creation until now (AFTER_CONNECTION)
   this->socket_ = std::make_unique<asio::ip::icmp::socket>(this->io_);
 
@@ -300,14 +818,39 @@ void Ping::setup() {
     }
   }
 
-  // setup each target with its index into targets_ and targets_.size().
-  // it will use index to set the id in each ICMP request packet it sends,
+  // bind our socket to our path, if any
+  if (!this->interface_.empty()) {
+    ifreq request{};
+    std::strncpy(request.ifr_name, this->interface_.c_str(), sizeof request.ifr_name - 1);
+    if (setsockopt(this->socket_->native_handle(), SOL_SOCKET, SO_BINDTODEVICE, &request, sizeof request)) {
+      ESP_LOGE(TAG, "socket bind to interface %s error: %s", this->interface_.c_str(), std::strerror(errno));
+      this->mark_failed();
+      return;
+    }
+  }
+  if (this->source_) {
+    std::error_code ec;
+    this->socket_->bind(asio::ip::icmp::endpoint(*this->source_, 0), ec);
+    if (ec) {
+      ESP_LOGE(TAG, "socket bind to source %s error: %s", this->source_->to_string().c_str(), ec.message().c_str());
+      this->mark_failed();
+      return;
+    }
+  }
+
+  // the phase of each target's periodic requests is relative to now
+  this->epoch_ = asio::steady_timer::clock_type::now();
+
+  // setup each target with its index into targets_.
+  // it will use index (offset by id_) to set the id in each ICMP request packet it sends,
   // which we will use to dispatch a matching reply back to the target.
-  // it will use index / size to calculate a phase offset in its periodic requests.
   {
     size_t index{0};
     for (auto &target : this->targets_) {
-      target->setup(index++, this->targets_.size());
+      target->setup(index++);
+    }
+    for (auto &sweep : this->sweeps_) {
+      sweep->setup(index++);
     }
   }
 
@@ -316,7 +859,9 @@ void Ping::setup() {
       [this]() -> asio::awaitable<void> {
         std::error_code ec;
         while (true) {
-          std::array<std::byte, IP_HEADER_SIZE_MAX + PACKET_SIZE> into{};  // receive into, at most, this
+          // receive into, at most, this.
+          // enough for an echo reply or a time exceeded reply that quotes the IP header and ICMP header of our request
+          std::array<std::byte, IP_HEADER_SIZE_MAX + ICMP_HEADER_SIZE + IP_HEADER_SIZE_MAX + PACKET_SIZE> into{};
           asio::ip::icmp::endpoint endpoint{};
           auto const received{co_await this->socket_->async_receive_from(
               asio::mutable_buffer(into.data(), into.size()), endpoint, asio::redirect_error(asio::use_awaitable, ec))};
@@ -327,33 +872,57 @@ void Ping::setup() {
             ESP_LOGW(TAG, "receive_from error: %s", ec.message().c_str());
             continue;
           }
-          if (received < IP_HEADER_SIZE_MIN + PACKET_SIZE) {
+          auto const timepoint{asio::steady_timer::clock_type::now()};
+          std::span<std::byte const> const onto{into.data(), received};  // received onto, exactly, this
+          auto const icmp_span{ip_payload(onto)};
+          if (icmp_span.size() < ICMP_HEADER_SIZE) {
             ESP_LOGW(TAG, "received runt reply (%zu) bytes", received);
             continue;
           }
-          std::span<std::byte const> const onto{into.data(), received};  // received onto, exactly, this
-          size_t const ip_header_size{sizeof(std::uint32_t) * (static_cast<std::uint8_t>(onto[0]) & 0x0F)};
-          if (ip_header_size < IP_HEADER_SIZE_MIN || ip_header_size > IP_HEADER_SIZE_MAX) {
-            ESP_LOGW(TAG, "received invalid IP header size (%zu bytes)", ip_header_size);
+          if (TIME_EXCEEDED == icmp_span[0]) {
+            // the IP header and ICMP header of our request follow the ICMP header of the reply
+            auto const quote{ip_payload(icmp_span.subspan(ICMP_HEADER_SIZE))};
+            if (quote.size() < ICMP_HEADER_SIZE || ECHO_REQUEST != quote[0]) {
+              ESP_LOGV(TAG, "received time exceeded for another request");
+              continue;
+            }
+            auto const sequence{network_uint16(quote.subspan(6))};
+            auto *const target{this->target(network_uint16(quote.subspan(4)))};
+            if (!target || !(sequence & TRACE)) {
+              ESP_LOGV(TAG, "received time exceeded for a foreign request");
+              continue;
+            }
+            target->trace_reply(endpoint.address().to_v4(), sequence, false, timepoint);
             continue;
           }
-          std::span<std::byte const> const packet_span{onto.subspan(ip_header_size)};  // packet follows IP header
-          if (!Packet::fits(packet_span)) {
-            ESP_LOGW(TAG, "received invalid packet size (%zu bytes)", packet_span.size());
+          if (!Packet::fits(icmp_span)) {
+            ESP_LOGW(TAG, "received invalid packet size (%zu bytes)", icmp_span.size());
             continue;
           }
-          Packet const packet{packet_span};
+          Packet const packet{icmp_span};
           if (!packet.is_reply()) {
             ESP_LOGW(TAG, "received packet is not a valid reply");
             continue;
           }
-          std::size_t const index{packet.id()};
-          if (index >= this->targets_.size()) {
-            ESP_LOGW(TAG, "received packet with invalid id %zu", index);
+          // every raw ICMP socket receives every reply, including those to another Ping
+          auto *const target{this->target(packet.id())};
+          if (!target) {
+            if (auto *const sweep{this->sweep(packet.id())}) {
+              sweep->reply(endpoint.address().to_v4(), packet.sequence());
+              continue;
+            }
+            ESP_LOGW(TAG, "received packet with foreign id %u", packet.id());
             continue;
           }
-          auto const timepoint{packet.timepoint()};
-          this->targets_[index]->reply(endpoint, packet.sequence(), timepoint);
+          if (endpoint.address() != target->endpoint_.address()) {
+            ESP_LOGW(TAG, "%s received reply from %s", target->tag_.c_str(), endpoint.address().to_string().c_str());
+            continue;
+          }
+          if (packet.sequence() & TRACE) {
+            target->trace_reply(endpoint.address().to_v4(), packet.sequence(), true, timepoint);
+            continue;
+          }
+          target->reply(endpoint, packet.sequence(), packet.timepoint());
         }
         this->socket_->close(ec);
         if (ec) {
@@ -370,23 +939,39 @@ bool Ping::teardown() {
   // undo setup
   for (auto &target : this->targets_) {
     if (target->timer_) {
+      target->rephased_ = false;  // so that the cancelled wait is not resumed
       auto const count{target->timer_->cancel()};
       ESP_LOGD(TAG, "teardown: %s timer cancelled %zu operations", target->tag_.c_str(), count);
     }
+    if (target->trace_timer_) {
+      auto const count{target->trace_timer_->cancel()};
+      ESP_LOGD(TAG, "teardown: %s trace timer cancelled %zu operations", target->tag_.c_str(), count);
+    }
+    target->cancel();
   }
-  if (this->socket_ && this->socket_->is_open()) {
-    std::error_code ec;
-    this->socket_->cancel(ec);
-    if (ec) {
-      ESP_LOGW(TAG, "teardown: socket cancel error: %s", ec.message().c_str());
-    } else {
-      ESP_LOGD(TAG, "teardown: socket cancelled");
+  for (auto &sweep : this->sweeps_) {
+    if (sweep->timer_) {
+      auto const count{sweep->timer_->cancel()};
+      ESP_LOGD(TAG, "teardown: %s timer cancelled %zu operations", sweep->tag_.c_str(), count);
     }
   }
+  // cancel the socket until the poll completes nothing more:
+  // a reply received before it was cancelled has the receive go round for another, which waits again
   size_t sum{0};
-  while (auto const addend{this->io_.poll()}) {
+  size_t addend;
+  do {
+    if (this->socket_ && this->socket_->is_open()) {
+      std::error_code ec;
+      this->socket_->cancel(ec);
+      if (ec) {
+        ESP_LOGW(TAG, "teardown: socket cancel error: %s", ec.message().c_str());
+      } else {
+        ESP_LOGD(TAG, "teardown: socket cancelled");
+      }
+    }
+    addend = this->io_.poll();
     sum += addend;
-  }
+  } while (addend);
   ESP_LOGD(TAG, "teardown: poll completed %zu operations", sum);
   if (this->socket_) {
     this->socket_.reset();
@@ -418,6 +1003,44 @@ void Ping::set_since(since_::Since *const since) {
   this->since_->update();
 }
 
+Target *Ping::target(std::uint16_t const id) const {
+  std::size_t const index{static_cast<std::uint16_t>(id - this->id_)};
+  return index < this->targets_.size() ? this->targets_[index] : nullptr;
+}
+
+Sweep *Ping::sweep(std::uint16_t const id) const {
+  std::size_t const index{static_cast<std::uint16_t>(id - this->id_ - this->targets_.size())};
+  return index < this->sweeps_.size() ? this->sweeps_[index] : nullptr;
+}
+
+void Ping::rephase() {
+  // spread the phase of each enabled target evenly across the shortest enabled interval.
+  // targets with the same interval, or a multiple of it, will never share a request timepoint.
+  // otherwise, coincidences are spread out by our bucket.
+  std::size_t size{0};
+  auto shortest{asio::steady_timer::duration::max()};
+  for (auto const *const target : this->targets_) {
+    if (target->state) {
+      ++size;
+      shortest = std::min(shortest, target->interval_);
+    }
+  }
+  using Rep = asio::steady_timer::duration::rep;
+  Rep rank{0};
+  auto const now{asio::steady_timer::clock_type::now()};
+  for (auto *const target : this->targets_) {
+    if (target->state) {
+      target->phase_ = shortest * rank++ / static_cast<Rep>(size) % target->interval_;
+      // a target waiting for its next request timepoint, in its old phase, waits for it in its new one.
+      // (re)setting the expiry of its timer cancels the wait, which it then resumes.
+      if (target->waiting_) {
+        target->rephased_ = true;
+        target->timer_->expires_at(target->next(now));
+      }
+    }
+  }
+}
+
 void Ping::publish() {
   auto unpublished{false};  // until an enabled target is unpublished
   auto none{true};          // until an enabled target is successful
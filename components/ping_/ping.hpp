@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
 #pragma GCC diagnostic ignored "-Wsign-conversion"
@@ -7,8 +12,11 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #pragma GCC diagnostic ignored "-Wsuggest-override"
 #pragma GCC diagnostic ignored "-Wc++11-compat"
+#pragma GCC diagnostic ignored "-Wnull-dereference"
 #include <asio/io_context.hpp>
 #include <asio/ip/icmp.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/ip/udp.hpp>
 #include <asio/steady_timer.hpp>
 #pragma GCC diagnostic pop
 
@@ -23,6 +31,7 @@
 #include "esphome/components/switch/switch.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/network/ip_address.h"
 #pragma GCC diagnostic pop
 
@@ -33,6 +42,34 @@ namespace ping_ {
 
 class Ping;
 
+// a token bucket (generic cell rate algorithm) that bounds the burst of probes sent by all targets (and sweeps)
+// of a Ping.
+// rather than refuse a probe that does not conform, reserve() defers it to when it would.
+class Bucket {
+ public:
+  void set_rate(float rate);
+  void set_burst(std::size_t burst);
+
+  // reserve a token for a probe to be sent at timepoint and return when it may be sent (not before timepoint)
+  asio::steady_timer::time_point reserve(asio::steady_timer::time_point timepoint);
+
+  float get_rate() const;
+  std::size_t get_burst() const { return this->burst_; }
+
+ private:
+  std::size_t burst_{1};
+  asio::steady_timer::duration emission_{};   // between probes at rate (zero is unlimited)
+  asio::steady_timer::duration tolerance_{};  // of early probes in a burst
+  asio::steady_timer::time_point arrival_{};  // theoretical arrival time of the next conforming probe
+};
+
+// how a Target is probed
+enum class Probe : std::uint8_t {
+  ICMP,  // echo request, echo reply
+  TCP,   // connect
+  UDP,   // request (payload), any response
+};
+
 class Target : public switch_::Switch {
   friend class Ping;
 
@@ -48,18 +85,38 @@ class Target : public switch_::Switch {
     this->timeout_ = asio::steady_timer::duration(std::chrono::nanoseconds(timeout));
   }
 
+  void set_probe(Probe const probe) { this->probe_ = probe; }
+  void set_port(std::uint16_t const port) { this->port_ = port; }
+  void set_payload(std::string const &payload) { this->payload_ = payload; }
+
   void set_able(binary_sensor::BinarySensor *able);
   void set_since(since_::Since *since);
 
-  void setup(std::size_t index, std::size_t size);
+  // trace the path to us on failure
+  void set_trace_hops(std::uint8_t hops);
+  void set_trace_holdoff(int64_t const holdoff) {
+    this->trace_holdoff_ = asio::steady_timer::duration(std::chrono::nanoseconds(holdoff));
+  }
+  void set_trace_text(text_sensor::TextSensor *const text) { this->trace_text_ = text; }
+
+  void setup(std::size_t index);
 
   void write_state(bool state) override;
 
  private:
   Ping *ping_{nullptr};
+  std::uint16_t id_{};  // of our ICMP requests
   asio::ip::icmp::endpoint endpoint_{};
   asio::steady_timer::duration interval_{};
   asio::steady_timer::duration timeout_{};
+  asio::steady_timer::duration phase_{};  // of our requests after the Ping epoch
+
+  Probe probe_{Probe::ICMP};
+  std::uint16_t port_{0};  // of TCP or UDP probe
+  std::string payload_{};  // of UDP probe
+  std::unique_ptr<asio::ip::tcp::socket> tcp_{};
+  std::unique_ptr<asio::ip::udp::socket> udp_{};
+  std::array<std::byte, 16> udp_buffer_{};  // receive (the start of) UDP response into
 
   std::string tag_{};
 
@@ -68,23 +125,110 @@ class Target : public switch_::Switch {
   asio::steady_timer::time_point reply_timepoint_{asio::steady_timer::time_point::min()};
   asio::steady_timer::time_point change_timepoint_{asio::steady_timer::time_point::min()};
   std::unique_ptr<asio::steady_timer> timer_{};
+  bool waiting_{false};   // for our next request timepoint, on timer_
+  bool rephased_{false};  // timer_ was cancelled to wait for it in our new phase instead
 
   binary_sensor::BinarySensor *able_{nullptr};
   since_::Since *since_{nullptr};
 
+  // compact path table, indexed by TTL - 1, filled by the last trace
+  struct Hop {
+    std::uint32_t address;  // of the router (or us) that replied, in host byte order
+    std::uint32_t sent;     // microseconds after trace_timepoint_ that the request was sent
+    std::uint32_t rtt;      // round trip time in microseconds, if replied
+  };
+  static constexpr std::uint32_t UNREPLIED{UINT32_MAX};
+  std::unique_ptr<Hop[]> trace_hops_{};  // only if tracing
+  std::uint8_t trace_size_{0};
+  std::uint8_t trace_reached_{0};     // TTL of the first echo reply from us (0 if none)
+  std::uint8_t trace_generation_{0};  // distinguishes replies to our last trace from those to earlier ones
+  bool tracing_{false};
+  asio::steady_timer::duration trace_holdoff_{};
+  asio::steady_timer::time_point trace_timepoint_{asio::steady_timer::time_point::min()};
+  std::unique_ptr<asio::steady_timer> trace_timer_{};
+  text_sensor::TextSensor *trace_text_{nullptr};
+
+  // return the first request timepoint in our phase after the given one
+  asio::steady_timer::time_point next(asio::steady_timer::time_point const &after) const;
+
   void publish(bool success, asio::steady_timer::time_point const &timepoint);
 
+  // initiate a TCP or UDP request, returning false on failure
+  bool request(std::uint16_t sequence, asio::steady_timer::time_point const &request_timepoint);
+  // connect (and open) our UDP socket, closing it on failure
+  std::error_code udp_connect();
+  // cancel any TCP or UDP request that has not completed
+  void cancel();
+
   void reply(asio::ip::icmp::endpoint const &endpoint, uint16_t sequence,
              asio::steady_timer::time_point const &timepoint);
+
+  // trace the path to us with echo requests of increasing TTL
+  void trace();
+  void trace_reply(asio::ip::address_v4 const &address, std::uint16_t sequence, bool reached,
+                   asio::steady_timer::time_point const &timepoint);
+  void trace_publish();
+};
+
+// sweep all addresses in a network with ICMP echo requests.
+// the state of each host is kept in a bitset rather than a Target.
+class Sweep {
+  friend class Ping;
+
+ public:
+  Sweep();
+
+  void set_ping(Ping *ping);
+  void set_network(esphome::network::IPAddress address, std::uint8_t prefix);
+  void set_interval(int64_t const interval) {
+    this->interval_ = asio::steady_timer::duration(std::chrono::nanoseconds(interval));
+  }
+  void set_timeout(int64_t const timeout) {
+    this->timeout_ = asio::steady_timer::duration(std::chrono::nanoseconds(timeout));
+  }
+  void set_rate(float rate) { this->bucket_.set_rate(rate); }
+  void set_batch(std::size_t batch) { this->bucket_.set_burst(batch); }
+
+  void set_count(sensor::Sensor *count);
+  void set_changes(sensor::Sensor *changes);
+
+  void setup(std::size_t index);
+
+ private:
+  Ping *ping_{nullptr};
+  std::uint16_t id_{};       // of our ICMP requests
+  std::uint32_t network_{};  // address, in host byte order
+  std::uint32_t first_{};    // offset of the first host in network
+  std::uint32_t last_{};     // offset of the last host in network
+  asio::steady_timer::duration interval_{};
+  asio::steady_timer::duration timeout_{};
+  Bucket bucket_{};  // our own, burst is our batch size (the Ping's bounds us too)
+
+  std::string tag_{};
+
+  // one bit per address offset in network
+  using Bits = std::vector<std::uint32_t>;
+  Bits live_{};        // as of the last sweep
+  Bits seen_{};        // in this sweep
+  bool swept_{false};  // once, so that live_ is of a sweep (not none)
+  std::unique_ptr<asio::steady_timer> timer_{};
+
+  sensor::Sensor *count_{nullptr};
+  sensor::Sensor *changes_{nullptr};
+
+  void reply(asio::ip::address_v4 const &address, std::uint16_t sequence);
+  void publish();
 };
 
 class Ping : public Component {
   friend class Target;
+  friend class Sweep;
 
  public:
   Ping();
 
   void add(Target *target);
+  void add(Sweep *sweep);
 
   void dump_config() override;
 
@@ -100,6 +244,10 @@ class Ping : public Component {
   void set_all(binary_sensor::BinarySensor *all);
   void set_count(sensor::Sensor *count);
   void set_since(since_::Since *since);
+  void set_interface(std::string const &interface) { this->interface_ = interface; }
+  void set_source(esphome::network::IPAddress source);
+  void set_rate(float rate) { this->bucket_.set_rate(rate); }
+  void set_burst(std::size_t burst) { this->bucket_.set_burst(burst); }
 
   void publish();
 
@@ -111,6 +259,26 @@ class Ping : public Component {
   since_::Since *since_{nullptr};
 
   std::vector<Target *> targets_{};
+  std::vector<Sweep *> sweeps_{};
+
+  // path that our requests take (default route if neither)
+  std::string interface_{};
+  std::optional<asio::ip::address_v4> source_{};
+
+  // first of the ICMP ids allocated to our targets (then sweeps).
+  // each Ping (path) allocates its own so that it can ignore replies to another.
+  std::uint16_t id_{};
+
+  Bucket bucket_{};
+  asio::steady_timer::time_point epoch_{};  // that the phase of each target is relative to
+
+  // spread the phase of each enabled target evenly
+  void rephase();
+
+  // return our target that was sent the ICMP id (nullptr if foreign)
+  Target *target(std::uint16_t id) const;
+  // return our sweep that was sent the ICMP id (nullptr if foreign)
+  Sweep *sweep(std::uint16_t id) const;
 
   asio::io_context io_{};
   std::unique_ptr<asio::ip::icmp::socket> socket_{};
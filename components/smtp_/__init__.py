@@ -5,33 +5,97 @@ import esphome.config_validation as cv
 import esphome.final_validate as fv
 from esphome.components.esp32 import CONF_SDKCONFIG_OPTIONS
 from esphome import automation
+from esphome.components import sensor
 from esphome.const import (
     CONF_ID,
+    CONF_NAME,
     CONF_PASSWORD,
     CONF_PORT,
+    CONF_TYPE,
     CONF_USERNAME,
     CONF_FRAMEWORK,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_SECOND,
     Platform,
 )
 
-DEPENDENCIES = ["asio_", "network"]
+DEPENDENCIES = ["asio_", "network", "sensor"]
 CODEOWNERS = ["@rtyle"]
 
+smtp_ns = cg.esphome_ns.namespace("smtp_")
+Component = smtp_ns.class_("Component", cg.Component)
+Action = smtp_ns.class_("Action", automation.Action)
+Stage = smtp_ns.enum("Stage", is_class=True)
+Drop = smtp_ns.enum("Drop", is_class=True)
+DROPS = {
+    "oldest": Drop.OLDEST,
+    "newest": Drop.NEWEST,
+}
+Priority = smtp_ns.enum("Priority", is_class=True)
+PRIORITIES = {
+    "low": Priority.LOW,
+    "normal": Priority.NORMAL,
+    "urgent": Priority.URGENT,
+}
+Transport = smtp_ns.enum("Transport", is_class=True)
+TRANSPORTS = {
+    "smtp": Transport.SMTP,
+    "syslog": Transport.SYSLOG,
+    "webhook": Transport.WEBHOOK,
+    "mqtt": Transport.MQTT,
+}
+# default port and path (webhook request target or MQTT topic) of each transport
+TRANSPORT_DEFAULTS = {
+    "smtp": (587, ""),
+    "syslog": (514, ""),
+    "webhook": (80, "/"),
+    "mqtt": (1883, "smtp_"),
+}
+
 CONF_SERVER = "server"
+CONF_TRANSPORT = "transport"
+CONF_PATH = "path"
 CONF_FROM = "from"
 CONF_TO = "to"
 CONF_STARTTLS = "starttls"
 CONF_CAS = "cas"
+CONF_IDLE = "idle"
+CONF_CAPACITY = "capacity"
+CONF_DROP = "drop"
+# a message like one already queued replaces it, and is counted, unless messages are spooled (whose records cannot be)
+CONF_COALESCE = "coalesce"
+CONF_DIGEST = "digest"
+CONF_SPOOL = "spool"
+CONF_RETRY = "retry"
+CONF_INITIAL = "initial"
+CONF_MAXIMUM = "maximum"
+CONF_ATTEMPTS = "attempts"
+CONF_DEPTH = "depth"
+CONF_AGE = "age"
+CONF_DEAD = "dead"
+CONF_DEADLINES = "deadlines"
+DEADLINES = {
+    "resolve": (Stage.RESOLVE, "10s"),
+    "connect": (Stage.CONNECT, "10s"),
+    "handshake": (Stage.HANDSHAKE, "20s"),
+    "command": (Stage.COMMAND, "30s"),
+    "data": (Stage.DATA, "60s"),
+    "shutdown": (Stage.SHUTDOWN, "5s"),
+}
+CONF_RESOLVE_TTL = "resolve_ttl"
+CONF_RELAYS = "relays"
+CONF_SHARD = "shard"
 CONF_SUBJECT = "subject"
 CONF_BODY = "body"
+CONF_PRIORITY = "priority"
+CONF_ATTACHMENTS = "attachments"
+CONF_GENERATOR = "generator"
 CONF_TASK_NAME = "task_name"
 CONF_TASK_PRIORITY = "task_priority"
+CONF_THREADED = "threaded"
 
 CONFIG_ASIO_SSL_SUPPORT = "CONFIG_ASIO_SSL_SUPPORT"
-
-smtp_ns = cg.esphome_ns.namespace("smtp_")
-Component = smtp_ns.class_("Component", cg.Component)
-Action = smtp_ns.class_("Action", automation.Action)
+CONFIG_MBEDTLS_CLIENT_SSL_SESSION_TICKETS = "CONFIG_MBEDTLS_CLIENT_SSL_SESSION_TICKETS"
 
 
 def string_from_file_or_value(value: object) -> str:
@@ -49,18 +113,70 @@ def string_from_file_or_value(value: object) -> str:
 
 MULTI_CONF = True
 
+RELAY_SCHEMA = {
+    cv.Required(CONF_SERVER): cv.string,
+    cv.Optional(CONF_PORT): cv.port,
+    cv.Optional(CONF_TRANSPORT, default="smtp"): cv.enum(TRANSPORTS, lower=True),
+    cv.Optional(CONF_PATH): cv.string,
+}
+
 CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
             cv.GenerateID(): cv.declare_id(Component),
-            cv.Required(CONF_SERVER): cv.string,
-            cv.Optional(CONF_PORT, default=587): cv.port,
+            **RELAY_SCHEMA,
+            cv.Optional(CONF_RELAYS, default=[]): cv.ensure_list(cv.Schema(RELAY_SCHEMA)),
+            cv.Optional(CONF_SHARD, default=False): cv.boolean,
             cv.Required(CONF_USERNAME): cv.string,
             cv.Required(CONF_PASSWORD): cv.string,
             cv.Required(CONF_FROM): cv.string,
             cv.Required(CONF_TO): cv.string,
             cv.Optional(CONF_STARTTLS, default=True): cv.boolean,
             cv.Optional(CONF_CAS): string_from_file_or_value,
+            cv.Optional(CONF_IDLE, default="0s"): cv.positive_time_period_nanoseconds,
+            cv.Optional(CONF_CAPACITY, default=16): cv.int_range(min=1),
+            cv.Optional(CONF_DROP, default="oldest"): cv.enum(DROPS, lower=True),
+            cv.Optional(CONF_COALESCE, default=False): cv.boolean,
+            cv.Optional(CONF_DIGEST, default="0s"): cv.positive_time_period_nanoseconds,
+            cv.Optional(CONF_SPOOL): cv.string_strict,
+            cv.Optional(CONF_RETRY, default={}): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_INITIAL, default="1min"
+                    ): cv.positive_time_period_nanoseconds,
+                    cv.Optional(
+                        CONF_MAXIMUM, default="1h"
+                    ): cv.positive_time_period_nanoseconds,
+                    cv.Optional(CONF_ATTEMPTS, default=8): cv.int_range(min=1),
+                }
+            ),
+            cv.Optional(CONF_DEADLINES, default={}): cv.Schema(
+                {
+                    cv.Optional(
+                        name, default=default
+                    ): cv.positive_time_period_nanoseconds
+                    for name, (_, default) in DEADLINES.items()
+                }
+            ),
+            cv.Optional(
+                CONF_RESOLVE_TTL, default="5min"
+            ): cv.positive_time_period_nanoseconds,
+            cv.Optional(CONF_TASK_NAME, default="smtp_"): cv.string_strict,
+            cv.Optional(CONF_TASK_PRIORITY, default=5): cv.int_range(min=0, max=24),
+            cv.Optional(CONF_THREADED, default=False): cv.boolean,
+            cv.Optional(CONF_DEPTH): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            cv.Optional(CONF_AGE): sensor.sensor_schema(
+                unit_of_measurement=UNIT_SECOND,
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            cv.Optional(CONF_DEAD): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
         }
     ).extend(cv.COMPONENT_SCHEMA),
 )
@@ -84,6 +200,7 @@ def _final_validate(config):
     )
     if sdkconfig_options is not None:
         sdkconfig_options[CONFIG_ASIO_SSL_SUPPORT] = "y"
+        sdkconfig_options[CONFIG_MBEDTLS_CLIENT_SSL_SESSION_TICKETS] = "y"
 
 
 FINAL_VALIDATE_SCHEMA = _final_validate
@@ -93,17 +210,55 @@ async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
 
-    cg.add(var.set_server(config[CONF_SERVER]))
-    cg.add(var.set_port(config[CONF_PORT]))
+    for relay_config in [config] + config[CONF_RELAYS]:
+        transport = relay_config[CONF_TRANSPORT]
+        port, path = TRANSPORT_DEFAULTS[transport]
+        cg.add(
+            var.add_relay(
+                relay_config[CONF_SERVER],
+                relay_config.get(CONF_PORT, port),
+                transport,
+                relay_config.get(CONF_PATH, path),
+            )
+        )
+    cg.add(var.set_shard(config[CONF_SHARD]))
     cg.add(var.set_username(config[CONF_USERNAME]))
     cg.add(var.set_password(config[CONF_PASSWORD]))
     cg.add(var.set_from(config[CONF_FROM]))
     cg.add(var.set_to(config[CONF_TO]))
     cg.add(var.set_starttls(config[CONF_STARTTLS]))
+    cg.add(var.set_idle(config[CONF_IDLE]))
+    cg.add(var.set_capacity(config[CONF_CAPACITY]))
+    cg.add(var.set_drop(config[CONF_DROP]))
+    cg.add(var.set_coalesce(config[CONF_COALESCE]))
+    cg.add(var.set_digest(config[CONF_DIGEST]))
 
     if CONF_CAS in config:
         cg.add(var.set_cas(config[CONF_CAS]))
 
+    if CONF_SPOOL in config:
+        cg.add(var.set_spool(config[CONF_SPOOL]))
+
+    retry_config = config[CONF_RETRY]
+    cg.add(var.set_retry_initial(retry_config[CONF_INITIAL]))
+    cg.add(var.set_retry_maximum(retry_config[CONF_MAXIMUM]))
+    cg.add(var.set_retry_attempts(retry_config[CONF_ATTEMPTS]))
+
+    cg.add(var.set_task_name(config[CONF_TASK_NAME]))
+    cg.add(var.set_task_priority(config[CONF_TASK_PRIORITY]))
+    cg.add(var.set_threaded(config[CONF_THREADED]))
+
+    for name, (stage, _) in DEADLINES.items():
+        cg.add(var.set_timeout(stage, config[CONF_DEADLINES][name]))
+    cg.add(var.set_resolve_ttl(config[CONF_RESOLVE_TTL]))
+
+    if CONF_DEPTH in config:
+        cg.add(var.set_depth(await sensor.new_sensor(config[CONF_DEPTH])))
+    if CONF_AGE in config:
+        cg.add(var.set_age(await sensor.new_sensor(config[CONF_AGE])))
+    if CONF_DEAD in config:
+        cg.add(var.set_dead(await sensor.new_sensor(config[CONF_DEAD])))
+
 
 @automation.register_action(
     "smtp_.send",
@@ -114,6 +269,16 @@ async def to_code(config):
             cv.Required(CONF_SUBJECT): cv.templatable(cv.string),
             cv.Optional(CONF_BODY): cv.templatable(cv.string),
             cv.Optional(CONF_TO): cv.templatable(cv.string),
+            cv.Optional(CONF_PRIORITY): cv.templatable(cv.enum(PRIORITIES, lower=True)),
+            cv.Optional(CONF_ATTACHMENTS): cv.ensure_list(
+                cv.Schema(
+                    {
+                        cv.Required(CONF_NAME): cv.string,
+                        cv.Optional(CONF_TYPE, default="application/octet-stream"): cv.string,
+                        cv.Required(CONF_GENERATOR): cv.returning_lambda,
+                    }
+                )
+            ),
         }
     ),
 )
@@ -132,4 +297,16 @@ async def smtp_send_to_code(config, action_id, template_arg, args):
         template_ = await cg.templatable(config[CONF_TO], args, cg.std_string)
         cg.add(action.set_to(template_))
 
+    if CONF_PRIORITY in config:
+        template_ = await cg.templatable(config[CONF_PRIORITY], args, Priority)
+        cg.add(action.set_priority(template_))
+
+    for attachment in config.get(CONF_ATTACHMENTS, []):
+        generator = await cg.process_lambda(
+            attachment[CONF_GENERATOR],
+            [(cg.size_t, "index"), (cg.RawExpression("std::span<char>"), "buffer")],
+            return_type=cg.size_t,
+        )
+        cg.add(action.add_attachment(attachment[CONF_NAME], attachment[CONF_TYPE], generator))
+
     return action
@@ -1,29 +1,22 @@
 #pragma once
 
 #include <array>
+#include <string>
 #include <string_view>
 #include <stdexcept>
+#include <type_traits>
 
 namespace concat {
 
 namespace detail {
 
-// return size of null terminated string_view input
-constexpr std::size_t size(std::string_view const input) {
-  auto const input_size{input.size()};
-#if defined(__cpp_exceptions)
-  if (!input_size)
-    throw std::invalid_argument("input must be null terminated");
-#endif
-  return input_size - 1;
-}
-
-// ^ delegate size from char(&)[size] or std::array<char, size>
-template<std::size_t size_> constexpr std::size_t size(char const (&input)[size_]) {
-  return size(std::string_view{input, size_});
-}
-template<std::size_t size_> constexpr std::size_t size(std::array<char, size_> const &input) {
-  return size(std::string_view{input.data(), size_});
+// size of a null terminated char[size] or std::array<char, size>, from its type (for a constant expression)
+template<typename Input> consteval std::size_t length() {
+  if constexpr (std::is_array_v<Input>) {
+    return std::extent_v<Input> - 1;
+  } else {
+    return std::tuple_size_v<Input> - 1;
+  }
 }
 
 // copy null terminated input to next part in output
@@ -52,7 +45,7 @@ template<std::size_t size> constexpr void copy(char *&output, std::array<char, s
 // (null terminated char(&)[size] or std::array<char, size>)
 template<typename... Inputs> consteval auto array(Inputs const &...inputs) {
   // output size is the sum of each null terminated input string plus 1
-  std::array<char, (detail::size(inputs) + ...) + 1> output;
+  std::array<char, (detail::length<Inputs>() + ...) + 1> output;
   // for each of the inputs, copy to the next part in output
   char *next{output.data()};
   (..., detail::copy(next, inputs));
@@ -69,4 +62,13 @@ template<std::size_t size> constexpr std::string_view view(std::array<char, size
   return {array.data(), size - 1};
 }
 
+// return a run-time std::string concatenation of all inputs (anything a std::string_view can be made from),
+// allocated once. this is for what is constant only once configured, to be built then rather than each use.
+template<typename... Inputs> std::string string(Inputs const &...inputs) {
+  std::string output;
+  output.reserve((std::string_view{inputs}.size() + ...));
+  (output.append(std::string_view{inputs}), ...);
+  return output;
+}
+
 }  // namespace concat
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wpedantic"
+#pragma GCC diagnostic error "-Wconversion"
+#pragma GCC diagnostic error "-Wsign-conversion"
+#pragma GCC diagnostic error "-Wold-style-cast"
+#pragma GCC diagnostic error "-Wshadow"
+#pragma GCC diagnostic error "-Wnull-dereference"
+#pragma GCC diagnostic error "-Wformat=2"
+#pragma GCC diagnostic error "-Wsuggest-override"
+#pragma GCC diagnostic error "-Wzero-as-null-pointer-constant"
+
+#include "multipart.hpp"
+
+#include <algorithm>
+#include <format>
+
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#include "mbedtls/base64.h"
+#pragma GCC diagnostic pop
+
+namespace esphome {
+namespace smtp_ {
+
+namespace {
+
+constexpr auto TAG{"smtp_.multipart"};
+
+constexpr char const CRLF[]{"\r\n"};
+
+// "=_" cannot appear in base64 content and is unlikely in text
+std::string make_boundary() { return std::format("=_smtp_{:08x}{:08x}", random_uint32(), random_uint32()); }
+
+}  // namespace
+
+Multipart::Multipart(std::string text)
+    : text_{std::move(text)},
+      attachments_{},
+      boundary_{make_boundary()},
+      headers_{std::format("MIME-Version: 1.0{}Content-Type: multipart/mixed; boundary=\"{}\"{}", CRLF,
+                           this->boundary_, CRLF)},
+      part_{0},
+      opened_{false},
+      index_{0},
+      carry_{0},
+      staged_{},
+      taken_{0},
+      line_{},
+      piece_{} {}
+
+void Multipart::attach(std::string name, std::string type, Generator generator) {
+  this->attachments_.push_back({std::move(name), std::move(type), std::move(generator)});
+}
+
+void Multipart::rewind() {
+  this->part_ = 0;
+  this->opened_ = false;
+  this->staged_.clear();
+  this->taken_ = 0;
+}
+
+std::size_t Multipart::produce(std::span<char> const buffer) {
+  std::size_t size{0};
+  while (size < buffer.size()) {
+    if (this->taken_ == this->staged_.size()) {
+      if (!this->stage()) {
+        break;
+      }
+      continue;
+    }
+    auto const count{std::min(buffer.size() - size, this->staged_.size() - this->taken_)};
+    std::copy_n(this->staged_.data() + this->taken_, count, buffer.data() + size);
+    this->taken_ += count;
+    size += count;
+  }
+  return size;
+}
+
+bool Multipart::stage() {
+  this->staged_.clear();
+  this->taken_ = 0;
+  if (0 == this->part_) {
+    this->staged_ = std::format("--{}{}Content-Type: text/plain; charset=utf-8{}{}{}{}", this->boundary_, CRLF, CRLF,
+                                CRLF, this->text_, CRLF);
+    ++this->part_;
+    return true;
+  }
+  if (this->part_ <= this->attachments_.size()) {
+    auto &attachment{this->attachments_[this->part_ - 1]};
+    if (!this->opened_) {
+      this->staged_ = std::format(
+          "--{}{}Content-Type: {}; name=\"{}\"{}Content-Disposition: attachment; filename=\"{}\"{}"
+          "Content-Transfer-Encoding: base64{}{}",
+          this->boundary_, CRLF, attachment.type, attachment.name, CRLF, attachment.name, CRLF, CRLF, CRLF);
+      this->opened_ = true;
+      this->index_ = 0;
+      this->carry_ = 0;
+      return true;
+    }
+    auto const size{attachment.generator(this->index_++, this->piece_)};
+    if (!size) {
+      // the last line, padded if short
+      if (this->carry_) {
+        this->encode({this->line_.data(), this->carry_});
+      }
+      ESP_LOGV(TAG, "attached %s in %zu pieces", attachment.name.c_str(), this->index_ - 1);
+      this->opened_ = false;
+      ++this->part_;
+      return true;
+    }
+    // encode whole lines and carry the rest over to the next piece
+    std::string_view piece{this->piece_.data(), std::min(size, this->piece_.size())};
+    while (!piece.empty()) {
+      auto const count{std::min(LINE - this->carry_, piece.size())};
+      std::copy_n(piece.data(), count, this->line_.data() + this->carry_);
+      this->carry_ += count;
+      piece.remove_prefix(count);
+      if (LINE == this->carry_) {
+        this->encode({this->line_.data(), LINE});
+        this->carry_ = 0;
+      }
+    }
+    return true;
+  }
+  if (this->part_ == this->attachments_.size() + 1) {
+    this->staged_ = std::format("--{}--{}", this->boundary_, CRLF);
+    ++this->part_;
+    return true;
+  }
+  return false;
+}
+
+void Multipart::encode(std::string_view const content) {
+  // 4 characters for each 3 bytes, then a NUL from mbedtls_base64_encode, replaced by our CRLF
+  auto const offset{this->staged_.size()};
+  auto const size{(content.size() + 2) / 3 * 4};
+  this->staged_.resize(offset + size + sizeof CRLF);
+  std::size_t written{0};
+  if (mbedtls_base64_encode(reinterpret_cast<unsigned char *>(this->staged_.data() + offset), size + 1, &written,
+                            reinterpret_cast<unsigned char const *>(content.data()), content.size())) {
+    ESP_LOGE(TAG, "base64 encode failed");
+    written = 0;
+  }
+  this->staged_.resize(offset + written);
+  this->staged_ += CRLF;
+}
+
+}  // namespace smtp_
+}  // namespace esphome
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "producer.hpp"
+
+namespace esphome {
+namespace smtp_ {
+
+// A MIME multipart/mixed message body (RFC 2045, RFC 2046) of a text part followed by attachments.
+// The content of each attachment is generated a piece at a time and base64 encoded as it is produced,
+// so that only a few lines of it are in memory at once.
+class Multipart : public Producer {
+ public:
+  static constexpr std::size_t PIECE{256};  // size of the buffer that a Generator fills
+
+  // fill buffer with piece index of the content (a line of a CSV file, say) and return its size, 0 at the end.
+  // index starts over from 0 for each attempt to send the message.
+  using Generator = std::function<std::size_t(std::size_t index, std::span<char> buffer)>;
+
+  explicit Multipart(std::string text);
+  Multipart(Multipart const &) = delete;
+  Multipart &operator=(Multipart const &) = delete;
+
+  // attach content from generator, as a file of this name and MIME type
+  void attach(std::string name, std::string type, Generator generator);
+
+  std::string_view headers() const override { return this->headers_; }
+  void rewind() override;
+  std::size_t produce(std::span<char> buffer) override;
+
+ private:
+  static constexpr std::size_t LINE{57};  // bytes of content encoded in each 76 character line
+
+  struct Attachment {
+    std::string name;
+    std::string type;
+    Generator generator;
+  };
+
+  // replace what has been staged with what follows it and return false at the end
+  bool stage();
+  // stage a line of content, base64 encoded
+  void encode(std::string_view content);
+
+  std::string const text_;
+  std::vector<Attachment> attachments_;
+  std::string const boundary_;  // between parts
+  std::string const headers_;
+
+  std::size_t part_;    // to be staged next: 0 is the text, then each attachment, then the close delimiter
+  bool opened_;         // whether the header of the attachment part_ has been staged
+  std::size_t index_;   // of the next piece of the attachment to generate
+  std::size_t carry_;   // bytes of content in line_, short of a whole line
+  std::string staged_;  // to be produced
+  std::size_t taken_;   // of staged_ that has been produced
+  std::array<char, LINE> line_;
+  std::array<char, PIECE> piece_;
+};
+
+}  // namespace smtp_
+}  // namespace esphome
@@ -0,0 +1,246 @@
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wpedantic"
+#pragma GCC diagnostic error "-Wconversion"
+#pragma GCC diagnostic error "-Wsign-conversion"
+#pragma GCC diagnostic error "-Wold-style-cast"
+#pragma GCC diagnostic error "-Wshadow"
+#pragma GCC diagnostic error "-Wnull-dereference"
+#pragma GCC diagnostic error "-Wformat=2"
+#pragma GCC diagnostic error "-Wsuggest-override"
+#pragma GCC diagnostic error "-Wzero-as-null-pointer-constant"
+
+#include "notify.hpp"
+
+#include <algorithm>
+#include <format>
+
+namespace esphome {
+namespace smtp_ {
+
+namespace {
+
+constexpr char const CRLF[]{"\r\n"};
+
+constexpr unsigned SYSLOG_FACILITY{1};  // user-level messages
+constexpr std::size_t SYSLOG_SIZE{1024};  // of a datagram, that older (RFC 3164) receivers accept too
+
+constexpr std::uint8_t MQTT_CONNECT{0x10};
+constexpr std::uint8_t MQTT_PUBLISH_QOS1{0x32};
+constexpr std::uint8_t MQTT_CLEAN_SESSION{0x02};
+constexpr std::uint8_t MQTT_PASSWORD{0x40};
+constexpr std::uint8_t MQTT_USERNAME{0x80};
+
+char lower(char const c) { return 'A' <= c && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; }
+
+bool iequals(std::string_view const a, std::string_view const b) {
+  return std::ranges::equal(a, b, [](char const x, char const y) { return lower(x) == lower(y); });
+}
+
+std::string_view trim(std::string_view value) {
+  while (!value.empty() && (' ' == value.front() || '\t' == value.front())) {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && (' ' == value.back() || '\t' == value.back())) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+// a syslog header field (HOSTNAME or APP-NAME) of printable characters, or the nil value
+std::string syslog_field(std::string_view const value, std::size_t const size) {
+  std::string field;
+  for (auto const c : value.substr(0, size)) {
+    field += '!' <= c && c <= '~' ? c : '_';
+  }
+  return field.empty() ? "-" : field;
+}
+
+void append_json(std::string &out, std::string_view const value) {
+  out += '"';
+  for (auto const c : value) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (0 <= c && c < ' ') {
+          out += std::format("\\u{:04x}", static_cast<unsigned>(c));
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += '"';
+}
+
+// an MQTT remaining length, 7 bits at a time, least significant first
+void append_length(std::string &out, std::size_t length) {
+  do {
+    auto byte{static_cast<std::uint8_t>(length % 128)};
+    length /= 128;
+    if (length) {
+      byte |= 0x80;
+    }
+    out += static_cast<char>(byte);
+  } while (length);
+}
+
+void append_uint16(std::string &out, std::uint16_t const value) {
+  out += static_cast<char>(value >> 8);
+  out += static_cast<char>(value & 0xff);
+}
+
+// an MQTT UTF-8 string, prefixed by its length
+void append_mqtt(std::string &out, std::string_view const value) {
+  append_uint16(out, static_cast<std::uint16_t>(value.size()));
+  out += value;
+}
+
+// an MQTT packet of type (and flags) with its variable header and payload
+std::string mqtt_packet(std::uint8_t const type, std::string const &rest) {
+  std::string packet;
+  packet.reserve(rest.size() + 5);
+  packet += static_cast<char>(type);
+  append_length(packet, rest.size());
+  packet += rest;
+  return packet;
+}
+
+}  // namespace
+
+std::string notify_json(std::string_view const subject, std::string_view const body, std::string_view const to,
+                        std::string_view const priority) {
+  std::string json;
+  json.reserve(subject.size() + body.size() + to.size() + 64);
+  json += "{\"subject\":";
+  append_json(json, subject);
+  json += ",\"body\":";
+  append_json(json, body);
+  json += ",\"to\":";
+  append_json(json, to);
+  json += ",\"priority\":";
+  append_json(json, priority);
+  json += '}';
+  return json;
+}
+
+std::string syslog_message(unsigned const severity, std::string_view const hostname, std::string_view const app,
+                           std::string_view const subject, std::string_view const body) {
+  // no TIMESTAMP, PROCID, MSGID or STRUCTURED-DATA: the receiver stamps it, and we may not know the time
+  auto message{std::format("<{}>1 - {} {} - - - ", SYSLOG_FACILITY * 8 + std::min(severity, 7u),
+                           syslog_field(hostname, 255), syslog_field(app, 48))};
+  auto const append{[&message](std::string_view const text) {
+    for (auto const c : text) {
+      if (SYSLOG_SIZE <= message.size()) {
+        break;
+      }
+      message += '\r' == c || '\n' == c || '\t' == c ? ' ' : c;
+    }
+  }};
+  append(subject);
+  if (!body.empty()) {
+    append(": ");
+    append(body);
+  }
+  // do not leave a UTF-8 sequence cut short
+  if (SYSLOG_SIZE <= message.size()) {
+    auto end{message.size()};
+    while (end && 0x80 == (static_cast<unsigned char>(message[end - 1]) & 0xc0)) {
+      --end;
+    }
+    if (end) {
+      auto const lead{static_cast<unsigned char>(message[end - 1])};
+      std::size_t const length{0xf0 <= lead ? 4u : 0xe0 <= lead ? 3u : 0xc0 <= lead ? 2u : 1u};
+      if (message.size() - (end - 1) < length) {
+        message.resize(end - 1);
+      }
+    }
+  }
+  return message;
+}
+
+std::string webhook_request(std::string_view const host, std::string_view const target,
+                            std::string_view const content) {
+  return std::format("POST {} HTTP/1.1{}Host: {}{}Content-Type: application/json{}Content-Length: {}{}{}{}",
+                     target.empty() ? "/" : target, CRLF, host, CRLF, CRLF, content.size(), CRLF, CRLF, content);
+}
+
+int http_status(std::string_view const line) {
+  // HTTP/1.x 200 OK
+  constexpr std::string_view version{"HTTP/1."};
+  constexpr std::size_t code{9};
+  if (line.size() < code + 3 || !line.starts_with(version) || ' ' != line[code - 1]) {
+    return 0;
+  }
+  int status{0};
+  for (auto const c : line.substr(code, 3)) {
+    if (c < '0' || '9' < c) {
+      return 0;
+    }
+    status = status * 10 + (c - '0');
+  }
+  return status;
+}
+
+std::string_view http_field(std::string_view fields, std::string_view const name) {
+  while (!fields.empty()) {
+    auto const end{fields.find(CRLF)};
+    auto const line{fields.substr(0, end)};
+    fields.remove_prefix(std::string_view::npos == end ? fields.size() : end + 2);
+    auto const colon{line.find(':')};
+    if (std::string_view::npos != colon && iequals(trim(line.substr(0, colon)), name)) {
+      return trim(line.substr(colon + 1));
+    }
+  }
+  return {};
+}
+
+std::string mqtt_connect(std::string_view const client, std::string_view const username,
+                         std::string_view const password, std::uint16_t const keep_alive) {
+  std::uint8_t flags{MQTT_CLEAN_SESSION};
+  if (!username.empty()) {
+    flags |= MQTT_USERNAME;
+    if (!password.empty()) {
+      flags |= MQTT_PASSWORD;
+    }
+  }
+  std::string rest;
+  append_mqtt(rest, "MQTT");
+  rest += '\x04';  // protocol level 3.1.1
+  rest += static_cast<char>(flags);
+  append_uint16(rest, keep_alive);
+  append_mqtt(rest, client);
+  if (flags & MQTT_USERNAME) {
+    append_mqtt(rest, username);
+  }
+  if (flags & MQTT_PASSWORD) {
+    append_mqtt(rest, password);
+  }
+  return mqtt_packet(MQTT_CONNECT, rest);
+}
+
+std::string mqtt_publish(std::string_view const topic, std::string_view const payload, std::uint16_t const id) {
+  std::string rest;
+  rest.reserve(topic.size() + payload.size() + 4);
+  append_mqtt(rest, topic);
+  append_uint16(rest, id);
+  rest += payload;
+  return mqtt_packet(MQTT_PUBLISH_QOS1, rest);
+}
+
+}  // namespace smtp_
+}  // namespace esphome
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace esphome {
+namespace smtp_ {
+
+// wire formats of the transports, other than SMTP, that a relay may take messages by.
+// each takes a message whole, in one datagram, request or packet.
+
+// a message as a JSON object of its subject, body, recipient and class
+std::string notify_json(std::string_view subject, std::string_view body, std::string_view to,
+                        std::string_view priority);
+
+// an RFC 5424 syslog message, for a UDP datagram (RFC 5426), from facility user at severity (0 to 7).
+// the subject and body go on one line, truncated to fit a datagram that any receiver should accept.
+std::string syslog_message(unsigned severity, std::string_view hostname, std::string_view app,
+                           std::string_view subject, std::string_view body);
+
+// an HTTP/1.1 POST request of content, as JSON, to target at host (with any port)
+std::string webhook_request(std::string_view host, std::string_view target, std::string_view content);
+
+// the status code of an HTTP/1.1 status line, or 0 if it is not one
+int http_status(std::string_view line);
+
+// the value of a header field in fields (each line with its terminator), or empty
+std::string_view http_field(std::string_view fields, std::string_view name);
+
+// MQTT 3.1.1 control packets
+std::string mqtt_connect(std::string_view client, std::string_view username, std::string_view password,
+                         std::uint16_t keep_alive);
+std::string mqtt_publish(std::string_view topic, std::string_view payload, std::uint16_t id);  // at QoS 1
+constexpr std::array<char, 2> MQTT_DISCONNECT{'\xe0', '\x00'};
+constexpr std::uint8_t MQTT_CONNACK{0x20};  // type of a packet received, in the high bits of its first byte
+constexpr std::uint8_t MQTT_PUBACK{0x40};
+
+}  // namespace smtp_
+}  // namespace esphome
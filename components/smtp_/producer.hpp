@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace esphome {
+namespace smtp_ {
+
+// A message body generated a piece at a time as it is sent, so that it need not be in memory at once
+class Producer {
+ public:
+  virtual ~Producer() = default;
+
+  // header fields, each with its line terminator, that describe the body
+  virtual std::string_view headers() const { return {}; }
+
+  // start over from the beginning of the body, before each attempt to send it
+  virtual void rewind() = 0;
+
+  // fill buffer with the next piece of the body and return its size, 0 at the end
+  virtual std::size_t produce(std::span<char> buffer) = 0;
+};
+
+}  // namespace smtp_
+}  // namespace esphome
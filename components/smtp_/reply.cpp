@@ -0,0 +1,61 @@
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wpedantic"
+#pragma GCC diagnostic error "-Wconversion"
+#pragma GCC diagnostic error "-Wsign-conversion"
+#pragma GCC diagnostic error "-Wold-style-cast"
+#pragma GCC diagnostic error "-Wshadow"
+#pragma GCC diagnostic error "-Wnull-dereference"
+#pragma GCC diagnostic error "-Wformat=2"
+#pragma GCC diagnostic error "-Wsuggest-override"
+#pragma GCC diagnostic error "-Wzero-as-null-pointer-constant"
+
+#include "reply.hpp"
+
+namespace esphome {
+namespace smtp_ {
+
+std::optional<ReplyLine> parse_reply_line(std::string_view const line) {
+  constexpr size_t size{3};
+  if (line.size() < size)
+    return {};
+  int code{0};
+  for (auto const c : line.substr(0, size)) {
+    if (c < '0' || '9' < c)
+      return {};
+    code = code * 10 + (c - '0');
+  }
+  if (line.size() == size)
+    return ReplyLine{code, {}, false};  // tolerate a bare code
+  switch (line[size]) {
+    case ' ':
+      return ReplyLine{code, line.substr(size + 1), false};
+    case '-':
+      return ReplyLine{code, line.substr(size + 1), true};
+    default:
+      return {};
+  }
+}
+
+std::optional<ReplyLine> ReplyParser::line(std::string_view const line) {
+  auto const reply_line{parse_reply_line(line)};
+  if (!reply_line)
+    return {};
+  // keep the text of a reply that is not positive to explain it
+  if (this->first_) {
+    this->code_ = reply_line->code;
+    this->keep_ = reply_line->code < 200 || 400 <= reply_line->code;
+  } else if (this->keep_) {
+    this->text_ += '\n';
+  }
+  if (this->keep_)
+    this->text_ += reply_line->text;
+  this->first_ = false;
+  return reply_line;
+}
+
+Reply ReplyParser::reply() && { return Reply{this->code_, std::move(this->text_)}; }
+
+}  // namespace smtp_
+}  // namespace esphome
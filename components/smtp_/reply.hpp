@@ -0,0 +1,56 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace esphome {
+namespace smtp_ {
+
+// wrap smtp Reply code and text with methods to interpret success or error.
+// text is only kept when it is needed to explain an error.
+class Reply {
+ private:
+  std::error_code const ec_;
+  int const code_;
+  std::string const text_;
+
+ public:
+  explicit Reply(std::error_code const ec) : ec_{ec}, code_{}, text_{ec.message()} {}
+  explicit Reply(int const code, std::string text = {}) : ec_{}, code_{code}, text_{std::move(text)} {}
+  bool is_positive_completion() const { return !this->ec_ && 200 <= this->code_ && this->code_ < 300; }
+  bool is_positive_intermediate() const { return !this->ec_ && 300 <= this->code_ && this->code_ < 400; }
+  bool is_negative_transient_completion() const { return !this->ec_ && 400 <= this->code_ && this->code_ < 500; }
+  bool is_negative_permanent_completion() const { return !this->ec_ && 500 <= this->code_ && this->code_ < 600; }
+  char const *text() const { return this->text_.c_str(); }
+};
+
+// a reply line, split into its code, text and whether another line follows
+struct ReplyLine {
+  int code;
+  std::string_view text;
+  bool more;
+};
+
+// parse a reply line (without its CRLF) in place
+std::optional<ReplyLine> parse_reply_line(std::string_view line);
+
+// assemble a (possibly multiline) Reply from its lines, presented in turn, where they lie.
+// nothing is allocated for a positive reply, whose text is not kept.
+class ReplyParser {
+ public:
+  // parse the next line (without its CRLF), keeping its text if need be. nothing if it is not a reply line.
+  std::optional<ReplyLine> line(std::string_view line);
+  // the Reply, after its last line (which is not followed by more)
+  Reply reply() &&;
+
+ private:
+  int code_{0};
+  bool first_{true};
+  bool keep_{false};
+  std::string text_{};
+};
+
+}  // namespace smtp_
+}  // namespace esphome
@@ -12,11 +12,17 @@
 #pragma GCC diagnostic error "-Wzero-as-null-pointer-constant"
 
 #include "smtp.hpp"
+#include "notify.hpp"
+#include "reply.hpp"
 
+#include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <format>
+#include <memory>
+#include <optional>
 #include <ranges>
-#include <thread>
+#include <span>
 
 // provide code generated from asio includes that follow below
 // visibility to our ASIO_NO_EXCEPTIONS asio::detail::throw_exception definition,
@@ -33,12 +39,16 @@
 #include <asio/co_spawn.hpp>
 #include <asio/connect.hpp>
 #include <asio/detached.hpp>
+#include <asio/ip/udp.hpp>
+#include <asio/read.hpp>
 #include <asio/read_until.hpp>
 #include <asio/redirect_error.hpp>
 #include <asio/ssl.hpp>
 #include <asio/streambuf.hpp>
 #pragma GCC diagnostic pop
 
+#include "esphome/core/application.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 
 #pragma GCC diagnostic push
@@ -52,8 +62,14 @@
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/error.h"
 #include "mbedtls/base64.h"
+#include "mbedtls/ssl.h"
 #pragma GCC diagnostic pop
 
+// the session id is private to mbedTLS 3 (and public to 2)
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
 namespace esphome {
 namespace smtp_ {
 
@@ -65,6 +81,23 @@ constexpr auto TAG{"smtp_"};
 
 constexpr char const CRLF[]{"\r\n"};  // SMTP protocol line terminator
 
+// fragments of commands and header fields, to be gathered around their variable parts
+constexpr auto RCPT_TO{concat::array("RCPT TO:<")};
+constexpr auto CLOSE{concat::array(">", CRLF)};
+constexpr auto TO_FIELD{concat::array("To: ")};
+constexpr auto SUBJECT_FIELD{concat::array("Subject: ")};
+constexpr auto DATA{concat::array("DATA", CRLF)};
+
+constexpr std::uint32_t WORKER_STACK{8192};  // enough for an mbedTLS handshake
+constexpr std::uint32_t IO_STACK{8192};      // enough for TLS record encryption
+
+constexpr std::chrono::milliseconds CONNECT_STAGGER{250};  // between connection attempts
+
+constexpr std::size_t CHUNK{1024};     // of a produced message body, in memory at once
+constexpr std::size_t BDAT_WINDOW{8};  // BDAT chunks, pipelined, before we wait for their replies
+
+constexpr std::uint16_t MQTT_KEEP_ALIVE{60};  // seconds, more than we wait between packets of a session
+
 // wrap mbedtls function result value with methods to interpret success or error
 class MbedTlsResult {
  private:
@@ -85,6 +118,14 @@ class MbedTlsResult {
   }
 };
 
+// whether a session is the one offered for resumption, by its id: a server that resumes it echoes that
+// (which, with a session ticket, is one that the client made up for it). a session without one is not resumed.
+bool resumed(mbedtls_ssl_session const &offered, mbedtls_ssl_session const &session) {
+  auto const size{static_cast<std::size_t>(offered.MBEDTLS_PRIVATE(id_len))};
+  return size && size == static_cast<std::size_t>(session.MBEDTLS_PRIVATE(id_len)) &&
+         std::equal(offered.MBEDTLS_PRIVATE(id), offered.MBEDTLS_PRIVATE(id) + size, session.MBEDTLS_PRIVATE(id));
+}
+
 // return size needed to base64_encode a value
 constexpr size_t base64_encoded_size(size_t const decoded_size) {
   constexpr size_t decoded{3};
@@ -92,40 +133,33 @@ constexpr size_t base64_encoded_size(size_t const decoded_size) {
   return ((decoded_size + (decoded - 1)) / decoded) * encoded;
 }
 
-// base64_encode in to out with SMTP line terminator appended
-MbedTlsResult base64_encode(std::string_view const in, std::string &out) {
-  auto const encoded_size_in{base64_encoded_size(in.size()) + 1};
-  auto encoded{std::make_unique<char[]>(encoded_size_in)};
+// base64_encode in to out, after prefix, with SMTP line terminator appended
+MbedTlsResult base64_encode(std::string_view const prefix, std::string_view const in, std::string &out) {
+  // size out once, with room for what mbedtls_base64_encode and we append
+  auto const encoded_size{base64_encoded_size(in.size())};
+  out.resize(prefix.size() + encoded_size + sizeof CRLF);
+  std::ranges::copy(prefix, out.begin());
+  auto *const encoded{out.data() + prefix.size()};
   size_t encoded_size_out;
-  MbedTlsResult const result{mbedtls_base64_encode(reinterpret_cast<unsigned char *>(encoded.get()), encoded_size_in,
+  MbedTlsResult const result{mbedtls_base64_encode(reinterpret_cast<unsigned char *>(encoded), encoded_size + 1,
                                                    &encoded_size_out,
                                                    reinterpret_cast<unsigned char const *>(in.data()), in.size())};
-  if (!result.is_error()) {
-    out = std::string(encoded.get()) + CRLF;
+  if (result.is_error()) {
+    out.clear();
+  } else {
+    std::ranges::copy(std::string_view{CRLF}, encoded + encoded_size_out);
+    out.resize(prefix.size() + encoded_size_out + sizeof CRLF - 1);
   }
   return result;
 }
 
-// wrap smtp Reply code and text with methods to interpret success or error
-class Reply {
- private:
-  std::error_code const ec_;
-  int const code_;
-  std::string const text_;
-
- public:
-  explicit Reply(std::error_code const ec) : ec_{ec}, code_{}, text_{} {}
-  explicit Reply(int const code, std::string_view const text = "") : ec_{}, code_{code}, text_{text} {}
-  bool is_positive_completion() const { return !this->ec_ && 200 <= this->code_ && this->code_ < 300; }
-  bool is_positive_intermediate() const { return !this->ec_ && 300 <= this->code_ && this->code_ < 400; }
-  bool is_negative_transient_completion() const { return !this->ec_ && 400 <= this->code_ && this->code_ < 500; }
-  bool is_negative_permanent_completion() const { return !this->ec_ && 500 <= this->code_ && this->code_ < 600; }
-  char const *text() const { return this->ec_ ? this->ec_.message().c_str() : this->text_.c_str(); }
-};
-
-template<typename AsyncReadStream, typename DynamicBuffer>
-asio::awaitable<Reply> receive_reply(AsyncReadStream &stream, DynamicBuffer &buffer) {
-  std::string text{};
+// receive a (possibly multiline) reply, presenting the text of each line to visit.
+// lines are parsed where they lie in buffer (which must be contiguous, like asio::streambuf)
+// and the text presented is only valid for the duration of the visit.
+template<typename AsyncReadStream, typename DynamicBuffer, typename Visit = void (*)(std::string_view)>
+asio::awaitable<Reply> receive_reply(AsyncReadStream &stream, DynamicBuffer &buffer,
+                                     Visit visit = [](std::string_view) {}) {
+  ReplyParser parser{};
   while (true) {
     // return the length of the sequence ending with the first CRLF
     // when the buffer sequence's get area contains CRLF (immediately, if already)
@@ -137,125 +171,418 @@ asio::awaitable<Reply> receive_reply(AsyncReadStream &stream, DynamicBuffer &buf
       co_return Reply{ec};
     }
 
-    // consume the line after extracting it
-    auto const begin{asio::buffers_begin(buffer.data())};
-    auto const end{begin + static_cast<std::ptrdiff_t>(length - (sizeof(CRLF) - 1))};
-    std::string const line{begin, end};
-    buffer.consume(length);
-    ESP_LOGI(TAG, "< %s", line.c_str());
-
-    // split the line into code and text, return when complete
-    constexpr size_t size{3};
-    constexpr auto isdigit{[](char const c) { return std::isdigit(static_cast<unsigned char>(c)); }};
-    if (size < line.size() && std::ranges::all_of(line | std::views::take(size), isdigit)) {
-      auto const code{std::stoi(line.substr(0, size))};
-      if (!text.empty())
-        text += '\n';
-      text += line.substr(size + 1);
-      switch (line[size]) {
-        case ' ':
-          co_return Reply{code, text};  // last line
-        case '-':
-          continue;  // another line
-        default:
-          co_return Reply{-1, std::format("bad code termination in reply line: {}", line)};
-      }
-    } else {
-      co_return Reply{-1, std::format("no code in reply line: {}", line)};
+    // view the line in place and consume it when done
+    auto const data{buffer.data()};
+    std::string_view const line{static_cast<char const *>(data.data()), length - (sizeof(CRLF) - 1)};
+    ESP_LOGD(TAG, "< %.*s", static_cast<int>(line.size()), line.data());
+    auto const reply_line{parser.line(line)};
+    if (!reply_line) {
+      Reply reply{-1, std::format("bad reply line: {}", line)};
+      buffer.consume(length);
+      co_return reply;
     }
+    visit(reply_line->text);
+    buffer.consume(length);
+
+    if (!reply_line->more)
+      co_return std::move(parser).reply();
   }
 }
 
-template<typename AsyncStream, typename DynamicBuffer>
+template<typename AsyncStream, typename DynamicBuffer, typename Visit = void (*)(std::string_view)>
 asio::awaitable<Reply> command(AsyncStream &stream, DynamicBuffer &buffer, std::string_view const request,
-                               std::string_view log = {}) {
+                               std::string_view log = {}, Visit visit = [](std::string_view) {}) {
   if (!log.data())
     log = request;
   ESP_LOGI(TAG, "> %.*s", log.size(), log.data());
   std::error_code ec;
-  auto const length{co_await asio::async_write(stream, asio::const_buffer{request.data(), request.size()},
-                                               asio::redirect_error(asio::use_awaitable, ec))};
+  co_await asio::async_write(stream, asio::const_buffer{request.data(), request.size()},
+                             asio::redirect_error(asio::use_awaitable, ec));
   if (ec) {
     ESP_LOGW(TAG, "write error: %s", ec.message().c_str());
     co_return Reply{ec};
   }
-  co_return co_await receive_reply(stream, buffer);
+  co_return co_await receive_reply(stream, buffer, std::move(visit));
 }
 
 // ^ delegate command from null terminated std::array<char, size>
-template<typename AsyncStream, typename DynamicBuffer, std::size_t size>
+template<typename AsyncStream, typename DynamicBuffer, std::size_t size,
+         typename Visit = void (*)(std::string_view)>
 asio::awaitable<Reply> command(AsyncStream &stream, DynamicBuffer &buffer, std::array<char, size> const &request,
-                               std::string_view log = {}) {
-  co_return co_await command(stream, buffer, std::string_view{request.data(), size - 1}, log);
+                               std::string_view log = {}, Visit visit = [](std::string_view) {}) {
+  co_return co_await command(stream, buffer, std::string_view{request.data(), size - 1}, log, std::move(visit));
+}
+
+// SMTP service extensions, advertised in reply to EHLO, that we may use
+enum Capability : std::uint8_t {
+  PIPELINING = 1 << 0,  // RFC 2920
+  AUTH_LOGIN = 1 << 1,  // RFC 4954
+  AUTH_PLAIN = 1 << 2,  // RFC 4954, RFC 4616
+  CHUNKING = 1 << 3,    // RFC 3030
+};
+using Capabilities = std::uint8_t;
+
+bool iequals(std::string_view const a, std::string_view const b) {
+  return std::ranges::equal(a, b, [](char const x, char const y) {
+    return std::toupper(static_cast<unsigned char>(x)) == std::toupper(static_cast<unsigned char>(y));
+  });
+}
+
+// return the capability advertised by a line of an EHLO reply, after the first (greeting) line.
+// each such line is an extension keyword and its parameters.
+Capabilities parse_capability(std::string_view const line) {
+  Capabilities capabilities{0};
+  auto words{line | std::views::split(' ')};
+  auto word{words.begin()};
+  if (word == words.end()) {
+    return capabilities;
+  }
+  std::string_view const keyword{(*word).begin(), (*word).end()};
+  if (iequals(keyword, "PIPELINING")) {
+    capabilities |= PIPELINING;
+  } else if (iequals(keyword, "CHUNKING")) {
+    capabilities |= CHUNKING;
+  } else if (iequals(keyword, "AUTH")) {
+    for (++word; word != words.end(); ++word) {
+      std::string_view const mechanism{(*word).begin(), (*word).end()};
+      if (iequals(mechanism, "LOGIN")) {
+        capabilities |= AUTH_LOGIN;
+      } else if (iequals(mechanism, "PLAIN")) {
+        capabilities |= AUTH_PLAIN;
+      }
+    }
+  }
+  return capabilities;
+}
+
+template<typename AsyncStream, typename DynamicBuffer>
+asio::awaitable<Reply> ehlo(AsyncStream &stream, DynamicBuffer &buffer, Capabilities &capabilities) {
+  static constexpr auto request{concat::array("EHLO esphome", CRLF)};
+  capabilities = 0;
+  bool greeting{true};
+  auto const reply{co_await command(stream, buffer, request, {}, [&](std::string_view const line) {
+    if (!greeting)
+      capabilities |= parse_capability(line);
+    greeting = false;
+  })};
+  if (!reply.is_positive_completion())
+    capabilities = 0;
+  co_return reply;
 }
 
 template<typename AsyncStream, typename DynamicBuffer>
-asio::awaitable<Reply> greeting_and_ehlo(AsyncStream &stream, DynamicBuffer &buffer) {
+asio::awaitable<Reply> greeting_and_ehlo(AsyncStream &stream, DynamicBuffer &buffer, Capabilities &capabilities) {
   {
     ESP_LOGD(TAG, "server greeting");
     auto const reply{co_await receive_reply(stream, buffer)};
     if (!reply.is_positive_completion())
       co_return reply;
   }
-  {
-    static constexpr auto request{concat::array("EHLO esphome", CRLF)};
-    auto const reply{co_await command(stream, buffer, request)};
-    co_return reply;
-  }
+  co_return co_await ehlo(stream, buffer, capabilities);
 }
 
-template<typename AsyncStream, typename DynamicBuffer>
-asio::awaitable<Reply> send(AsyncStream &stream, DynamicBuffer &buffer, std::string_view from, std::string_view subject,
-                            std::string_view body, std::string_view to) {
-  {
-    std::string const request{std::format("MAIL FROM:<{}>{}", from, CRLF)};
-    auto const reply{co_await command(stream, buffer, request)};
-    if (!reply.is_positive_completion()) {
-      ESP_LOGW(TAG, "command MAIL FROM: %s", reply.text());
-      co_return reply;
+// present a message body, dot-stuffed (RFC 5321 4.5.2), as a sequence of pieces
+// that refer to the body itself or to a static "." to be inserted before a line that begins with one.
+// the body may be a part of one that does not start a line.
+class DotStuffed {
+ private:
+  std::string_view rest_;
+  bool dot_;
+
+ public:
+  explicit DotStuffed(std::string_view const body, bool const start = true)
+      : rest_{body}, dot_{start && body.starts_with('.')} {}
+  bool empty() const { return !this->dot_ && this->rest_.empty(); }
+  std::string_view next() {
+    if (this->dot_) {
+      this->dot_ = false;
+      return ".";
     }
+    auto const position{this->rest_.find("\n.")};
+    auto const size{position == std::string_view::npos ? this->rest_.size() : position + 1};
+    auto const piece{this->rest_.substr(0, size)};
+    this->rest_.remove_prefix(size);
+    this->dot_ = position != std::string_view::npos;
+    return piece;
   }
-  {
-    std::string const request{std::format("RCPT TO:<{}>{}", to, CRLF)};
-    auto const reply{co_await command(stream, buffer, request)};
-    if (!reply.is_positive_completion()) {
-      ESP_LOGW(TAG, "command RCPT TO: %s", reply.text());
-      co_return reply;
+};
+
+// fragments of a header, gathered without copying them
+using Fragments = std::span<std::string_view const>;
+
+// write the fragments of a prefix, the pieces of a dot-stuffed body and a suffix.
+// these are gathered, without copying the body, into a bounded number of buffers for each write.
+template<typename AsyncStream>
+asio::awaitable<std::error_code> write_stuffed(AsyncStream &stream, Fragments const prefix, DotStuffed stuffed,
+                                               std::string_view const suffix) {
+  std::array<asio::const_buffer, 16> buffers;
+  size_t count{0};
+  for (auto const fragment : prefix) {
+    buffers[count++] = asio::buffer(fragment);
+  }
+  while (true) {
+    while (count < buffers.size() && !stuffed.empty()) {
+      auto const piece{stuffed.next()};
+      buffers[count++] = asio::const_buffer{piece.data(), piece.size()};
     }
+    bool const last{stuffed.empty() && count < buffers.size()};
+    if (last) {
+      buffers[count++] = asio::const_buffer{suffix.data(), suffix.size()};
+    }
+    std::error_code ec;
+    co_await asio::async_write(stream, std::span{buffers.data(), count},
+                               asio::redirect_error(asio::use_awaitable, ec));
+    if (ec || last) {
+      co_return ec;
+    }
+    count = 0;
   }
-  {
-    static constexpr auto request{concat::array("DATA", CRLF)};
-    auto const reply{co_await command(stream, buffer, request)};
-    if (!reply.is_positive_intermediate()) {
-      ESP_LOGW(TAG, "command DATA: %s", reply.text());
-      co_return reply;
+}
+
+constexpr auto DATA_TERMINATOR{concat::array(CRLF, ".", CRLF)};
+
+// write the header, dot-stuffed body and terminator of a DATA command
+template<typename AsyncStream>
+asio::awaitable<std::error_code> write_data(AsyncStream &stream, Fragments const header, std::string_view const body) {
+  co_return co_await write_stuffed(stream, header, DotStuffed{body},
+                                   std::string_view{DATA_TERMINATOR.data(), DATA_TERMINATOR.size() - 1});
+}
+
+// ^ with the body produced a chunk at a time.
+// a line may span chunks, so whether a chunk starts a line carries over from the last.
+template<typename AsyncStream>
+asio::awaitable<std::error_code> write_data(AsyncStream &stream, Fragments header, Producer &producer) {
+  std::array<char, CHUNK> chunk;
+  auto start{true};
+  while (true) {
+    std::string_view const piece{chunk.data(), producer.produce(chunk)};
+    auto const ec{co_await write_stuffed(
+        stream, header, DotStuffed{piece, start},
+        piece.empty() ? std::string_view{DATA_TERMINATOR.data(), DATA_TERMINATOR.size() - 1} : std::string_view{})};
+    if (ec || piece.empty()) {
+      co_return ec;
     }
+    header = {};
+    start = piece.ends_with('\n');
   }
-  {
-    static constexpr auto format{concat::array("From: {}", CRLF, "To: {}", CRLF, "Subject: {}", CRLF, CRLF)};
-    std::string const request{std::format(format.data(), from, to, subject)};
+}
+
+// write a BDAT command and its chunk of the fragments of a prefix and body
+template<typename AsyncStream>
+asio::awaitable<std::error_code> write_bdat(AsyncStream &stream, Fragments const prefix, std::string_view const body,
+                                            bool const last) {
+  static constexpr auto bdat{concat::array("BDAT ")};
+  static constexpr auto tail{concat::array(" LAST", CRLF)};  // the CRLF alone, if not last
+  auto size{body.size()};
+  for (auto const fragment : prefix) {
+    size += fragment.size();
+  }
+  std::array<char, 24> digits;
+  auto const end{std::to_chars(digits.begin(), digits.end(), size).ptr};
+  std::string_view const suffix{last ? concat::view(tail) : concat::view(tail).substr(sizeof " LAST" - 1)};
+  ESP_LOGD(TAG, "> BDAT %.*s%s", static_cast<int>(end - digits.begin()), digits.data(), last ? " LAST" : "");
+  std::array<asio::const_buffer, 16> buffers;
+  size_t count{0};
+  buffers[count++] = asio::buffer(concat::view(bdat));
+  buffers[count++] = asio::buffer(digits.data(), static_cast<std::size_t>(end - digits.begin()));
+  buffers[count++] = asio::buffer(suffix);
+  for (auto const fragment : prefix) {
+    buffers[count++] = asio::buffer(fragment);
+  }
+  buffers[count++] = asio::buffer(body);
+  std::error_code ec;
+  co_await asio::async_write(stream, std::span{buffers.data(), count}, asio::redirect_error(asio::use_awaitable, ec));
+  co_return ec;
+}
+
+// transfer the header and body in BDAT chunks (RFC 3030), which need no dot-stuffing or terminator.
+// a body in memory goes in one chunk with the header.
+// a produced body goes a chunk at a time, through a small fixed buffer, and then an empty last chunk.
+// if pipelined, up to BDAT_WINDOW chunks go before we wait for their replies.
+// after a reply that is not positive, no more chunks go and it is returned.
+template<typename AsyncStream, typename DynamicBuffer>
+asio::awaitable<Reply> transfer_bdat(AsyncStream &stream, DynamicBuffer &buffer, bool const pipelined, Fragments header,
+                                     std::string_view const body, Producer *const producer) {
+  auto const window{pipelined ? BDAT_WINDOW : std::size_t{1}};
+  std::array<char, CHUNK> chunk;
+  std::size_t outstanding{0};
+  std::optional<Reply> failure;
+  while (true) {
+    auto piece{body};
+    auto last{true};
+    if (producer) {
+      piece = {chunk.data(), producer->produce(chunk)};
+      last = piece.empty();
+    }
+    auto const ec{co_await write_bdat(stream, header, piece, last)};
+    if (ec) {
+      ESP_LOGW(TAG, "command BDAT write: %s", ec.message().c_str());
+      co_return Reply{ec};
+    }
+    header = {};
+    ++outstanding;
+    while (outstanding && (last || failure || window <= outstanding)) {
+      auto reply{co_await receive_reply(stream, buffer)};
+      --outstanding;
+      if (!reply.is_positive_completion() && !reply.is_negative_transient_completion() &&
+          !reply.is_negative_permanent_completion()) {
+        co_return reply;  // the session failed
+      }
+      if (!reply.is_positive_completion() && !failure) {
+        ESP_LOGW(TAG, "command BDAT: %s", reply.text());
+        failure.emplace(std::move(reply));
+      } else if (last && !outstanding && !failure) {
+        co_return reply;
+      }
+    }
+    if (failure) {
+      co_return *failure;
+    }
+  }
+}
+
+// commands and header fields that are constant once configured, built then (see Component::set_from and set_to)
+struct Prebuilt {
+  std::string_view mail_from;  // command
+  std::string_view rcpt_to;    // command, to the default recipient
+  std::string_view from;       // header field
+  std::string_view to;         // header field, of the default recipient
+  std::string_view recipient;  // default
+};
+
+// send a message, to the default recipient if to is empty,
+// with its body in memory or, if producer, produced a chunk at a time.
+// its commands and header are gathered from prebuilt fragments and those of the message, without copying them.
+// its content goes by BDAT, if the server is CHUNKING, or else DATA.
+template<typename AsyncStream, typename DynamicBuffer>
+asio::awaitable<Reply> send(AsyncStream &stream, DynamicBuffer &buffer, Capabilities const capabilities,
+                            Prebuilt const &prebuilt, std::string_view const to, std::string_view const subject,
+                            std::string_view const body, Producer *const producer) {
+  std::string_view const crlf{CRLF};
+  auto const chunking{0 != (capabilities & CHUNKING)};
+  if (capabilities & PIPELINING) {
+    // send the envelope commands in one write and match their replies in order.
+    // with CHUNKING, BDAT follows after these replies instead of DATA.
+    std::array<asio::const_buffer, 5> request{
+        asio::buffer(prebuilt.mail_from),
+        asio::buffer(to.empty() ? prebuilt.rcpt_to : concat::view(RCPT_TO)),
+    };
+    std::size_t count{2};
+    if (!to.empty()) {
+      request[count++] = asio::buffer(to);
+      request[count++] = asio::buffer(concat::view(CLOSE));
+    }
+    if (!chunking) {
+      request[count++] = asio::buffer(concat::view(DATA));
+    }
+    auto const recipient{to.empty() ? prebuilt.recipient : to};
+    ESP_LOGI(TAG, "> MAIL FROM, RCPT TO:<%.*s>%s", static_cast<int>(recipient.size()), recipient.data(),
+             chunking ? "" : ", DATA");
     std::error_code ec;
-    auto const length{co_await asio::async_write(stream, asio::const_buffer{request.data(), request.size()},
-                                                 asio::redirect_error(asio::use_awaitable, ec))};
+    co_await asio::async_write(stream, std::span{request.data(), count},
+                               asio::redirect_error(asio::use_awaitable, ec));
     if (ec) {
-      ESP_LOGW(TAG, "command DATA From, To, Subject: %s", ec.message().c_str());
-      co_return Reply{-1};
+      ESP_LOGW(TAG, "write error: %s", ec.message().c_str());
+      co_return Reply{ec};
+    }
+    // but for none after one that fails the session, as there are no more to come
+    auto const failed{[](Reply const &reply) {
+      return !reply.is_positive_completion() && !reply.is_positive_intermediate() &&
+             !reply.is_negative_transient_completion() && !reply.is_negative_permanent_completion();
+    }};
+    auto const mail_reply{co_await receive_reply(stream, buffer)};
+    if (failed(mail_reply)) {
+      ESP_LOGW(TAG, "command MAIL FROM: %s", mail_reply.text());
+      co_return mail_reply;
+    }
+    auto const rcpt_reply{co_await receive_reply(stream, buffer)};
+    std::optional<Reply> data_reply;
+    if (!chunking && !failed(rcpt_reply)) {
+      data_reply.emplace(co_await receive_reply(stream, buffer));
+    }
+    if (!mail_reply.is_positive_completion() || !rcpt_reply.is_positive_completion()) {
+      if (data_reply && data_reply->is_positive_intermediate()) {
+        // the server should not have, but it accepted DATA for a failed envelope. end it, empty.
+        static constexpr auto request_{concat::array(".", CRLF)};
+        co_await command(stream, buffer, request_);
+      }
+      if (!mail_reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "command MAIL FROM: %s", mail_reply.text());
+        co_return mail_reply;
+      }
+      ESP_LOGW(TAG, "command RCPT TO: %s", rcpt_reply.text());
+      co_return rcpt_reply;
+    }
+    if (data_reply && !data_reply->is_positive_intermediate()) {
+      ESP_LOGW(TAG, "command DATA: %s", data_reply->text());
+      co_return *data_reply;
     }
-    ESP_LOGI(TAG, "> %s", request.c_str());
+  } else {
+    {
+      auto const reply{co_await command(stream, buffer, prebuilt.mail_from)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "command MAIL FROM: %s", reply.text());
+        co_return reply;
+      }
+    }
+    {
+      // to the default recipient, prebuilt, or else this one, built now
+      auto request{prebuilt.rcpt_to};
+      std::string built;
+      if (!to.empty()) {
+        built = concat::string(concat::view(RCPT_TO), to, concat::view(CLOSE));
+        request = built;
+      }
+      auto const reply{co_await command(stream, buffer, request)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "command RCPT TO: %s", reply.text());
+        co_return reply;
+      }
+    }
+    if (!chunking) {
+      auto const reply{co_await command(stream, buffer, DATA)};
+      if (!reply.is_positive_intermediate()) {
+        ESP_LOGW(TAG, "command DATA: %s", reply.text());
+        co_return reply;
+      }
+    }
+  }
+  // a produced body may add header fields of its own (MIME, say)
+  std::array const header{
+      prebuilt.from,
+      to.empty() ? prebuilt.to : concat::view(TO_FIELD),
+      to,
+      to.empty() ? std::string_view{} : crlf,
+      concat::view(SUBJECT_FIELD),
+      subject,
+      crlf,
+      producer ? producer->headers() : std::string_view{},
+      crlf,
+  };
+  if (producer) {
+    ESP_LOGI(TAG, "> Subject: %.*s (produced body)", static_cast<int>(subject.size()), subject.data());
+    producer->rewind();
+  } else {
+    ESP_LOGI(TAG, "> Subject: %.*s (%zu byte body)", static_cast<int>(subject.size()), subject.data(), body.size());
+    ESP_LOGV(TAG, "> %.*s", static_cast<int>(body.size()), body.data());
   }
-  if (!body.empty()) {
+  if (chunking) {
+    co_return co_await transfer_bdat(stream, buffer, 0 != (capabilities & PIPELINING), header, body, producer);
+  }
+  {
     std::error_code ec;
-    auto const length{co_await asio::async_write(stream, asio::const_buffer{body.data(), body.size()},
-                                                 asio::redirect_error(asio::use_awaitable, ec))};
+    if (producer) {
+      ec = co_await write_data(stream, header, *producer);
+    } else {
+      ec = co_await write_data(stream, header, body);
+    }
     if (ec) {
-      ESP_LOGW(TAG, "command DATA body: %s", ec.message().c_str());
-      co_return Reply{-1};
+      ESP_LOGW(TAG, "command DATA write: %s", ec.message().c_str());
+      co_return Reply{ec};
     }
-    ESP_LOGI(TAG, "> %.*s", body.size(), body.data());
   }
   {
-    static constexpr auto request{concat::array(CRLF, ".", CRLF)};
-    auto const reply{co_await command(stream, buffer, request)};
+    auto const reply{co_await receive_reply(stream, buffer)};
     if (!reply.is_positive_completion()) {
       ESP_LOGW(TAG, "command DATA end: %s", reply.text());
     }
@@ -263,49 +590,378 @@ asio::awaitable<Reply> send(AsyncStream &stream, DynamicBuffer &buffer, std::str
   }
 }
 
-template<typename Function, typename Result = std::invoke_result_t<Function>>
-  requires std::is_trivially_copyable_v<Result>  // implies std::atomic<Result> will work
-asio::awaitable<Result> async_on_thread(Function &&function) {
-  auto executor = co_await asio::this_coro::executor;
+// send a datagram, which is all there is to it: nothing acknowledges it
+asio::awaitable<Reply> send_datagram(asio::ip::udp::socket &socket, std::string_view const datagram) {
+  std::error_code ec;
+  co_await socket.async_send(asio::buffer(datagram), asio::redirect_error(asio::use_awaitable, ec));
+  if (ec) {
+    ESP_LOGW(TAG, "datagram send error: %s", ec.message().c_str());
+    co_return Reply{ec};
+  }
+  co_return Reply{250};
+}
 
-  std::atomic<Result> result{};
-  std::atomic<bool> done{false};
+// POST a request and receive its response, in terms of an SMTP reply:
+// 2xx is accepted, 408, 429 and 5xx may be retried and anything else is refused.
+// close is set if the server will not take another request on this connection.
+template<typename AsyncStream, typename DynamicBuffer>
+asio::awaitable<Reply> post(AsyncStream &stream, DynamicBuffer &buffer, std::string_view const request, bool &close) {
+  std::error_code ec;
+  co_await asio::async_write(stream, asio::buffer(request), asio::redirect_error(asio::use_awaitable, ec));
+  if (ec) {
+    ESP_LOGW(TAG, "post write error: %s", ec.message().c_str());
+    co_return Reply{ec};
+  }
+  static constexpr auto end{concat::array(CRLF, CRLF)};
+  auto const length{co_await asio::async_read_until(stream, buffer, concat::view(end),
+                                                    asio::redirect_error(asio::use_awaitable, ec))};
+  if (ec) {
+    ESP_LOGW(TAG, "post read until error: %s", ec.message().c_str());
+    co_return Reply{ec};
+  }
+  auto const data{buffer.data()};
+  std::string_view const buffered{static_cast<char const *>(data.data()), data.size()};
+  auto const head{buffered.substr(0, length)};
+  auto const line{head.substr(0, head.find(CRLF))};
+  ESP_LOGD(TAG, "< %.*s", static_cast<int>(line.size()), line.data());
+  auto const status{http_status(line)};
+  auto const fields{head.substr(line.size() + 2)};
+  std::size_t content{0};
+  auto const content_length{http_field(fields, "Content-Length")};
+  std::from_chars(content_length.data(), content_length.data() + content_length.size(), content);
+  // we do not follow a chunked response, so cannot find the end of it
+  close = iequals(http_field(fields, "Connection"), "close") || !http_field(fields, "Transfer-Encoding").empty();
+  std::string text;
+  if (status < 200 || 300 <= status) {
+    text = line;  // to explain it
+  }
+  buffer.consume(length);
+  if (!status) {
+    close = true;
+    co_return Reply{-1, std::format("bad status line: {}", text)};
+  }
 
-  std::thread([&result, &done, executor, function = std::forward<Function>(function)]() mutable {
-    result = function();
-    done = true;
-    asio::post(executor, []() {});  // post noop to wake the executor
-  }).detach();
+  // discard the content of the response
+  if (!close && buffer.size() < content) {
+    co_await asio::async_read(stream, buffer, asio::transfer_exactly(content - buffer.size()),
+                              asio::redirect_error(asio::use_awaitable, ec));
+    if (ec) {
+      ESP_LOGW(TAG, "post read error: %s", ec.message().c_str());
+      co_return Reply{ec};
+    }
+  }
+  buffer.consume(content);
+
+  if (200 <= status && status < 300) {
+    co_return Reply{250};
+  }
+  if (408 == status || 429 == status || 500 <= status) {
+    co_return Reply{451, std::move(text)};
+  }
+  co_return Reply{550, std::move(text)};
+}
+
+// write an MQTT packet and read the 4 byte packet of type (and then id) that acknowledges it
+template<typename AsyncStream>
+asio::awaitable<Reply> acknowledged(AsyncStream &stream, std::string_view const packet, std::uint8_t const type,
+                                    std::uint16_t const id = 0) {
+  std::error_code ec;
+  co_await asio::async_write(stream, asio::buffer(packet), asio::redirect_error(asio::use_awaitable, ec));
+  if (ec) {
+    ESP_LOGW(TAG, "mqtt write error: %s", ec.message().c_str());
+    co_return Reply{ec};
+  }
+  std::array<std::uint8_t, 4> ack;
+  co_await asio::async_read(stream, asio::buffer(ack), asio::redirect_error(asio::use_awaitable, ec));
+  if (ec) {
+    ESP_LOGW(TAG, "mqtt read error: %s", ec.message().c_str());
+    co_return Reply{ec};
+  }
+  if (type != ack[0] || 2 != ack[1]) {
+    co_return Reply{-1, std::format("unexpected packet 0x{:02x}", static_cast<unsigned>(ack[0]))};
+  }
+  if (MQTT_CONNACK == type) {
+    // a return code that refuses the connection
+    if (ack[3]) {
+      co_return Reply{-1, std::format("connection refused: {}", static_cast<unsigned>(ack[3]))};
+    }
+  } else if (id != (ack[2] << 8 | ack[3])) {
+    co_return Reply{-1, std::format("unexpected packet id {}", ack[2] << 8 | ack[3])};
+  }
+  co_return Reply{250};
+}
+
+// a job for a worker that completes handler, on executor, with the error_code that function returns
+template<typename Executor, typename Function, typename Handler> class Completion : public Worker::Job {
+ private:
+  Executor executor_;
+  Function function_;
+  Handler handler_;
 
-  while (!done) {
-    co_await asio::post(executor, asio::use_awaitable);  // suspend until executor wakes
+ public:
+  Completion(Executor executor, Function function, Handler handler)
+      : executor_{std::move(executor)}, function_{std::move(function)}, handler_{std::move(handler)} {}
+  void run() override { this->complete(this->function_()); }
+  void complete(std::error_code const result) {
+    asio::post(this->executor_,
+               [completion = std::move(this->handler_), result]() mutable { std::move(completion)(result); });
   }
+};
 
-  co_return result;
+// co_await the error_code returned by function, performed by worker,
+// which posts its completion back to our executor rather than have us poll for it.
+// if worker cannot take it (its queue is full), it completes at once with an error instead.
+template<typename Function> asio::awaitable<std::error_code> async_on_worker(Worker &worker, Function &&function) {
+  auto const executor{co_await asio::this_coro::executor};
+  std::error_code ec;
+  co_await asio::async_initiate<decltype(asio::redirect_error(asio::use_awaitable, ec)), void(std::error_code)>(
+      [&worker, &executor, &function](auto handler) {
+        using Job = Completion<std::decay_t<decltype(executor)>, std::decay_t<Function>, decltype(handler)>;
+        std::unique_ptr<Worker::Job> job{
+            std::make_unique<Job>(executor, std::forward<Function>(function), std::move(handler))};
+        if (!worker.submit(job)) {
+          static_cast<Job &>(*job).complete(std::make_error_code(std::errc::resource_unavailable_try_again));
+        }
+      },
+      asio::redirect_error(asio::use_awaitable, ec));
+  co_return ec;
 }
 
+// a race to connect to the first of several endpoints to answer
+struct Race {
+  explicit Race(asio::any_io_executor const &executor) : wake{executor} {}
+  asio::steady_timer wake;                        // cancelled when an attempt finishes
+  std::vector<asio::ip::tcp::socket *> attempts;  // in progress
+  std::size_t running{0};                         // attempts
+  bool cancelled{false};
+  std::error_code ec;  // of the last attempt to fail
+  std::optional<asio::ip::tcp::socket> winner;
+  asio::ip::tcp::endpoint endpoint;  // of the winner
+  void cancel() {
+    this->cancelled = true;
+    for (auto *const attempt : this->attempts) {
+      std::error_code ignored;
+      attempt->cancel(ignored);
+    }
+    this->wake.cancel();
+  }
+};
+
+// start an attempt to connect to each endpoint in turn, but do not wait more than stagger
+// for one before also starting the next (RFC 8305). the first to connect wins and the rest are cancelled.
+asio::awaitable<void> run_race(std::shared_ptr<Race> const race, std::vector<asio::ip::tcp::endpoint> const endpoints,
+                               asio::steady_timer::duration const stagger) {
+  auto const executor{co_await asio::this_coro::executor};
+  for (auto const &endpoint : endpoints) {
+    if (race->winner || race->cancelled) {
+      break;
+    }
+    ++race->running;
+    asio::co_spawn(
+        executor,
+        [race, endpoint]() -> asio::awaitable<void> {
+          asio::ip::tcp::socket socket{race->wake.get_executor()};
+          race->attempts.push_back(&socket);
+          std::error_code ec;
+          co_await socket.async_connect(endpoint, asio::redirect_error(asio::use_awaitable, ec));
+          std::erase(race->attempts, &socket);
+          if (ec) {
+            race->ec = ec;
+          } else if (!race->winner) {
+            race->winner.emplace(std::move(socket));
+            race->endpoint = endpoint;
+            race->cancel();
+          }
+          --race->running;
+          race->wake.cancel();
+        },
+        asio::detached);
+    // until stagger or an attempt finishes
+    race->wake.expires_after(stagger);
+    std::error_code ignored;
+    co_await race->wake.async_wait(asio::redirect_error(asio::use_awaitable, ignored));
+  }
+  while (!race->winner && race->running) {
+    race->wake.expires_at(asio::steady_timer::time_point::max());
+    std::error_code ignored;
+    co_await race->wake.async_wait(asio::redirect_error(asio::use_awaitable, ignored));
+  }
+}
+
+constexpr std::array<char const *, STAGES> STAGE_NAMES{
+    "resolve", "connect", "handshake", "command", "data", "shutdown",
+};
+
+constexpr std::array<char const *, PRIORITIES> PRIORITY_NAMES{
+    "low",
+    "normal",
+    "urgent",
+};
+
+// of syslog messages of each class: informational, notice and critical
+constexpr std::array<unsigned, PRIORITIES> PRIORITY_SEVERITIES{6, 5, 2};
+
+constexpr std::array<char const *, 4> TRANSPORT_NAMES{
+    "smtp",
+    "syslog",
+    "webhook",
+    "mqtt",
+};
+
+// count elapsed time in its histogram bucket
+void record(Histogram &histogram, std::chrono::steady_clock::duration const duration) {
+  auto const elapsed{std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()};
+  std::size_t bucket{0};
+  while (bucket + 1 < histogram.size() && (decltype(elapsed){1} << bucket) <= elapsed) {
+    ++bucket;
+  }
+  if (histogram[bucket] < UINT16_MAX) {
+    ++histogram[bucket];
+  }
+}
+
+// describe the buckets of histogram that have counts
+std::string describe(Histogram const &histogram) {
+  std::string text;
+  for (std::size_t bucket{0}; bucket < histogram.size(); ++bucket) {
+    if (auto const count{histogram[bucket]}) {
+      text += bucket + 1 < histogram.size() ? std::format(" <{}ms:{}", 1u << bucket, count)
+                                            : std::format(" >={}ms:{}", 1u << (bucket - 1), count);
+    }
+  }
+  return text;
+}
+
+// cancel what a stage of a session waits on if it does not finish in time,
+// and record how long it took.
+class Deadline {
+ private:
+  asio::steady_timer timer_;
+  std::chrono::steady_clock::time_point const start_;
+  Histogram &histogram_;
+  unsigned &generation_;
+
+ public:
+  template<typename Cancel>
+  Deadline(asio::io_context &io, Stage const stage, asio::steady_timer::duration const timeout, Histogram &histogram,
+           unsigned &generation, Cancel cancel)
+      : timer_{io}, start_{std::chrono::steady_clock::now()}, histogram_{histogram}, generation_{generation} {
+    if (timeout.count()) {
+      this->timer_.expires_after(timeout);
+      // the wait may complete after we are gone. cancel only if we are not.
+      this->timer_.async_wait([stage, &generation, armed = generation, cancel](std::error_code const ec) {
+        if (!ec && armed == generation) {
+          ESP_LOGW(TAG, "%s deadline passed", STAGE_NAMES[static_cast<std::size_t>(stage)]);
+          cancel();
+        }
+      });
+    }
+  }
+  Deadline(Deadline const &) = delete;
+  Deadline &operator=(Deadline const &) = delete;
+  ~Deadline() {
+    ++this->generation_;
+    std::error_code ignored;
+    this->timer_.cancel(ignored);
+    record(this->histogram_, std::chrono::steady_clock::now() - this->start_);
+  }
+};
+
 }  // namespace
 
 Component::Component()
-    : server_{},
-      port_{587},
+    : relays_{},
+      shard_{false},
       username_{},
       password_{},
+      auth_plain_{},
+      auth_login_username_{},
+      auth_login_password_{},
       from_{},
       to_{},
+      mail_from_command_{},
+      rcpt_to_command_{},
+      from_field_{},
+      to_field_{},
       starttls_{true},
       cas_{},
+      idle_{},
+      capacity_{16},
+      drop_{Drop::OLDEST},
+      coalesce_{false},
+      digest_{},
+      spool_{},
+      retry_initial_{std::chrono::minutes(1)},
+      retry_maximum_{std::chrono::hours(1)},
+      retry_attempts_{8},
+      timeouts_{std::chrono::seconds(10), std::chrono::seconds(10), std::chrono::seconds(20),
+                std::chrono::seconds(30), std::chrono::seconds(60), std::chrono::seconds(5)},
+      resolve_ttl_{std::chrono::minutes(5)},
+      depth_sensor_{nullptr},
+      age_sensor_{nullptr},
+      dead_sensor_{nullptr},
+      task_name_{"smtp_"},
+      task_priority_{5},
+      threaded_{false},
       io_{},
+      work_{},
+      arrivals_{nullptr},
       queue_{},
+      flying_{0},
+      dropped_{0},
+      dead_{0},
+      sessions_{0},
+      failures_{0},
+      delivered_{0},
+      deferred_{0},
+      stopped_{false},
+      resolve_hits_{0},
+      resolve_misses_{0},
+      latencies_{},
+      deliveries_{},
       queue_timer_{},
       interval_timer_{},
-      ssl_{asio::ssl::context::tlsv12_client},
-      stream_{} {}
+      worker_{},
+      ssl_{asio::ssl::context::tlsv12_client} {}
+
+Component::~Component() {
+  // io_ goes before relays_, as the coroutines that it still holds use them.
+  // the stream and idle timer of each relay run on io_, so they go before it.
+  for (auto &relay : this->relays_) {
+    relay.stream.reset();
+    relay.idle_timer.reset();
+  }
+}
+
+Component::Relay::Relay(std::string const &server_name, uint16_t const server_port, Transport const relay_transport,
+                        std::string const &relay_path)
+    : server{server_name},
+      port{server_port},
+      transport{relay_transport},
+      path{relay_path},
+      endpoints{},
+      resolved{},
+      good{},
+      down{},
+      idle_timer{},
+      stream{},
+      session{} {
+  mbedtls_ssl_session_init(&this->session);
+}
+
+Component::Relay::~Relay() { mbedtls_ssl_session_free(&this->session); }
 
 void Component::dump_config() {
   ESP_LOGCONFIG(TAG, "SMTP Client:");
-  ESP_LOGCONFIG(TAG, "  server: %s", this->server_.c_str());
-  ESP_LOGCONFIG(TAG, "  port: %d", this->port_);
+  ESP_LOGCONFIG(TAG, "  relays:");
+  for (auto const &relay : this->relays_) {
+    ESP_LOGCONFIG(TAG, "    %s, port %u, %s", relay.server.c_str(), relay.port,
+                  TRANSPORT_NAMES[static_cast<std::size_t>(relay.transport)]);
+    if (!relay.path.empty()) {
+      ESP_LOGCONFIG(TAG, "      %s: %s", Transport::MQTT == relay.transport ? "topic" : "path", relay.path.c_str());
+    }
+  }
+  ESP_LOGCONFIG(TAG, "  shard: %s", this->shard_ ? "true" : "false");
 #if 0
   ESP_LOGCONFIG(TAG, "  username: %s", this->username_.c_str());
   ESP_LOGCONFIG(TAG, "  password: %s", this->password_.c_str());
@@ -313,8 +969,38 @@ void Component::dump_config() {
   ESP_LOGCONFIG(TAG, "  from: %s", this->from_.c_str());
   ESP_LOGCONFIG(TAG, "  to: %s", this->to_.c_str());
   ESP_LOGCONFIG(TAG, "  starttls: %s", this->starttls_ ? "true" : "false");
-  ESP_LOGCONFIG(TAG, "  task_name: %s", this->task_name_);
-  ESP_LOGCONFIG(TAG, "  task_priority: %s", this->task_priority_);
+  ESP_LOGCONFIG(TAG, "  idle: %lld ms",
+                std::chrono::duration_cast<std::chrono::milliseconds>(this->idle_).count());
+  ESP_LOGCONFIG(TAG, "  capacity: %zu", this->capacity_);
+  ESP_LOGCONFIG(TAG, "  drop: %s", this->drop_ == Drop::OLDEST ? "oldest" : "newest");
+  ESP_LOGCONFIG(TAG, "  coalesce: %s",
+                !this->coalesce_ ? "false"
+                : this->spool_   ? "true (but not of spooled messages)"
+                                 : "true");
+  ESP_LOGCONFIG(TAG, "  digest: %lld ms",
+                std::chrono::duration_cast<std::chrono::milliseconds>(this->digest_).count());
+  if (this->spool_) {
+    ESP_LOGCONFIG(TAG, "  spool: %s (%zu bytes)", this->spool_->get_label().c_str(), this->spool_->get_size());
+  }
+  ESP_LOGCONFIG(TAG, "  retry:");
+  ESP_LOGCONFIG(TAG, "    initial: %lld ms",
+                std::chrono::duration_cast<std::chrono::milliseconds>(this->retry_initial_).count());
+  ESP_LOGCONFIG(TAG, "    maximum: %lld ms",
+                std::chrono::duration_cast<std::chrono::milliseconds>(this->retry_maximum_).count());
+  ESP_LOGCONFIG(TAG, "    attempts: %u", this->retry_attempts_);
+  ESP_LOGCONFIG(TAG, "  deadlines:");
+  for (std::size_t stage{0}; stage < STAGES; ++stage) {
+    ESP_LOGCONFIG(TAG, "    %s: %lld ms", STAGE_NAMES[stage],
+                  std::chrono::duration_cast<std::chrono::milliseconds>(this->timeouts_[stage]).count());
+  }
+  ESP_LOGCONFIG(TAG, "  resolve_ttl: %lld ms",
+                std::chrono::duration_cast<std::chrono::milliseconds>(this->resolve_ttl_).count());
+  LOG_SENSOR("  ", "depth", this->depth_sensor_);
+  LOG_SENSOR("  ", "age", this->age_sensor_);
+  LOG_SENSOR("  ", "dead", this->dead_sensor_);
+  ESP_LOGCONFIG(TAG, "  threaded: %s", this->threaded_ ? "true" : "false");
+  ESP_LOGCONFIG(TAG, "  task_name: %s", this->task_name_.c_str());
+  ESP_LOGCONFIG(TAG, "  task_priority: %u", this->task_priority_);
 }
 
 float Component::get_setup_priority() const { return esphome::setup_priority::AFTER_CONNECTION; }
@@ -322,6 +1008,12 @@ float Component::get_setup_priority() const { return esphome::setup_priority::AF
 void Component::setup() {
   ESP_LOGD(TAG, "setup");
 
+  if (this->relays_.empty()) {
+    ESP_LOGE(TAG, "no relays");
+    this->mark_failed();
+    return;
+  }
+
   if (!this->cas_.empty()) {
     ESP_LOGD(TAG, "parse CA certificates");
     std::error_code ec;
@@ -334,9 +1026,25 @@ void Component::setup() {
     }
   }
 
+  // for blocking work (the TLS handshake), one job at a time, queued for as many as there are relays
+  // (each with a session, and so a handshake, at a time) so that concurrent sessions wait their turn
+  if (!this->worker_.start(this->task_name_.c_str(), this->task_priority_, WORKER_STACK, this->relays_.size())) {
+    this->mark_failed();
+    return;
+  }
+
+  // the age of the oldest message changes without the queue changing
+  if (this->age_sensor_) {
+    this->set_interval("age", 60 * 1000, [this]() { asio::post(this->io_, [this]() { this->publish_queue(); }); });
+  }
+  this->publish_queue();
+
   // we must wait until AFTER_CONNECTION for timer construction
   this->queue_timer_.emplace(this->io_);
   this->interval_timer_.emplace(this->io_);
+  for (auto &relay : this->relays_) {
+    relay.idle_timer.emplace(this->io_);
+  }
 
   asio::co_spawn(
       this->io_,
@@ -353,8 +1061,8 @@ void Component::setup() {
             co_await this->queue_timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
             if (ec) {
               if (ec == asio::error::operation_aborted) {
-                // cancelled by enqueue (!queue_.empty) or teardown (queue_.empty)
-                if (this->queue_.empty()) {
+                // cancelled by enqueue or teardown
+                if (this->stopped_) {
                   ESP_LOGD(TAG, "abort: queue timer %s", ec.message().c_str());
                   break;  // teardown
                 }
@@ -365,181 +1073,52 @@ void Component::setup() {
             }
           }
 
-          // session
-          auto shutdown{false};
-          do {
-            this->stream_.emplace(co_await asio::this_coro::executor, this->ssl_);
-
-            this->stream_->set_verify_mode(this->cas_.empty() ? asio::ssl::verify_none : asio::ssl::verify_peer, ec);
-            if (ec) {
-              ESP_LOGW(TAG, "ssl stream set verify mode error: %s", ec.message().c_str());
-              break;
-            }
-            {
-              MbedTlsResult const result{mbedtls_ssl_set_hostname(
-                  reinterpret_cast<mbedtls_ssl_context *>(this->stream_->native_handle()), this->server_.c_str())};
-              if (result.is_error()) {
-                ESP_LOGW(TAG, "ssl set hostname error: %s:", result.to_string().c_str());
-                break;
-              }
-            }
-
-            {
-              asio::ip::tcp::resolver resolver{co_await asio::this_coro::executor};
-              auto const endpoints{co_await resolver.async_resolve(this->server_, std::to_string(this->port_),
-                                                                   asio::redirect_error(asio::use_awaitable, ec))};
-              if (ec) {
-                ESP_LOGW(TAG, "resolve %s, port %u error: %s", this->server_.c_str(), this->port_,
-                         ec.message().c_str());
-                break;
-              }
-              co_await asio::async_connect(this->stream_->lowest_layer(), endpoints,
-                                           asio::redirect_error(asio::use_awaitable, ec));
-              if (ec) {
-                ESP_LOGW(TAG, "connect server %s, port %u error: %s", this->server_.c_str(), this->port_,
-                         ec.message().c_str());
-                break;
-              }
-            }
-
-            this->stream_->lowest_layer().non_blocking(true, ec);
-            if (ec) {
-              ESP_LOGW(TAG, "set non blocking error: %s", ec.message().c_str());
-              break;
-            }
-
-            // greeting_and_ehlo and ssl handshake ordered per this->starttls_
-            asio::streambuf buffer;
-            if (this->starttls_) {
-              {
-                auto const reply{co_await greeting_and_ehlo(this->stream_->next_layer(), buffer)};
-                if (!reply.is_positive_completion()) {
-                  ESP_LOGW(TAG, "greeting and ehlo: %s", reply.text());
-                  break;
-                }
+          // collect what else is queued during the digest window and fold it all into one message.
+          // an urgent message does not wait for it (and cuts it short if it comes during it).
+          if (this->digest_.count() && !this->queue_.empty() && Priority::URGENT != this->queue_.front().priority) {
+            this->interval_timer_->expires_after(this->digest_);
+            co_await this->interval_timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            if (ec == asio::error::operation_aborted) {
+              if (this->stopped_) {
+                ESP_LOGD(TAG, "abort: digest timer %s", ec.message().c_str());
+                break;  // teardown
               }
-              {
-                static constexpr auto request{concat::array("STARTTLS", CRLF)};
-                auto const reply{co_await command(this->stream_->next_layer(), buffer, request)};
-                if (!reply.is_positive_completion()) {
-                  ESP_LOGW(TAG, "request STARTTLS: %s", reply.text());
-                  break;
-                }
-              }
-            }
-            {
-#if 0
-              // the espressif/asio port of async_handshake is not asynchronous
-              // esphome will complain it takes too long (~500 > 30ms)
-              co_await this->stream_->async_handshake(asio::ssl::stream_base::client, asio::redirect_error(asio::use_awaitable, ec));
-#else
-              // co_await the equivalent performed on another thread
-              ec = co_await async_on_thread([this]() {
-                std::error_code ec_;
-                this->stream_->lowest_layer().non_blocking(false, ec_);
-                if (!ec_) {
-                  this->stream_->handshake(asio::ssl::stream_base::client, ec_);
-                  this->stream_->lowest_layer().non_blocking(true);
-                }
-                return ec_;
-              });
-#endif
-              if (ec) {
-                ESP_LOGW(TAG, "handshake error: %s", ec.message().c_str());
-                break;
-              }
-            }
-            shutdown = true;
-            if (!this->starttls_) {
-              auto const reply{co_await greeting_and_ehlo(*this->stream_, buffer)};
-              if (!reply.is_positive_completion()) {
-                ESP_LOGW(TAG, "greeting and ehlo: %s", reply.text());
-                break;
-              }
-            }
-
-            // login
-            {
-              static constexpr auto request{concat::array("AUTH LOGIN", CRLF)};
-              auto const reply{co_await command(*this->stream_, buffer, request)};
-              if (!reply.is_positive_intermediate()) {
-                ESP_LOGW(TAG, "command AUTH LOGIN %s", reply.text());
-                break;
-              }
-            }
-            {
-              std::string request;
-              auto const result{base64_encode(this->username_, request)};
-              if (result.is_error()) {
-                ESP_LOGW(TAG, "base64_encode: %s", result.to_string().c_str());
-                break;
-              }
-              auto const reply{co_await command(*this->stream_, buffer, request)};
-              if (!reply.is_positive_intermediate()) {
-                ESP_LOGW(TAG, "command AUTH LOGIN username: %s", reply.text());
-                break;
-              }
-            }
-            {
-              std::string request;
-              auto const result{base64_encode(this->password_, request)};
-              if (result.is_error()) {
-                ESP_LOGW(TAG, "base64_encode: %s", result.to_string().c_str());
-                break;
-              }
-              static constexpr auto log{"<redacted>"};
-              auto const reply{co_await command(*this->stream_, buffer, request, log)};
-              if (!reply.is_positive_completion()) {
-                ESP_LOGW(TAG, "command AUTH LOGIN password: %s", reply.text());
-                break;
-              }
-            }
-
-            // send each message in the queue until it is empty
-            while (!this->queue_.empty()) {
-              const auto &message{this->queue_.front()};
-              auto const reply{co_await send(*this->stream_, buffer, this->from_, message.subject, message.body,
-                                             message.to.empty() ? this->to_ : message.to)};
-              if (!reply.is_positive_completion()) {
-                break;  // try again next session
-              }
-              this->queue_.pop_front();
+              ESP_LOGD(TAG, "digest window cut short by urgent message");
+              ec.clear();
+            } else if (ec) {
+              ESP_LOGW(TAG, "digest timer error: %s", ec.message().c_str());
+              ec.clear();
             }
+            this->fold();
+          }
 
-            // quit session
-            {
-              static constexpr auto request{concat::array("QUIT", CRLF)};
-              auto const reply{co_await command(*this->stream_, buffer, request)};
-              if (!reply.is_positive_completion()) {
-                ESP_LOGW(TAG, "command QUIT: %s", reply.text());
-                break;
-              }
-            }
-          } while (false);
-
-          // session/stream cleanup
-          if (this->stream_) {
-            if (shutdown) {
-              co_await this->stream_->async_shutdown(asio::redirect_error(asio::use_awaitable, ec));
-              if (ec) {
-                ESP_LOGW(TAG, "shutdown ssl stream error: %s", ec.message().c_str());
-              }
-            }
-            if (this->stream_->lowest_layer().is_open()) {
-              this->stream_->lowest_layer().close(ec);
-              if (ec) {
-                ESP_LOGW(TAG, "close socket error: %s", ec.message().c_str());
-              }
-            }
-            this->stream_.reset();
+          // a round of sessions, through one relay after another or all at once
+          this->delivered_ = 0;
+          this->deferred_ = 0;
+          auto const outcome{co_await this->deliver()};
+          this->log_latencies();
+          if (Outcome::STOPPED == outcome || this->stopped_) {
+            break;  // teardown
+          }
+          // what came during a round that delivered (and deferred nothing) is sent at once.
+          // a round that delivered nothing, as when an idle session is lost, or deferred something, is backed off from.
+          if (this->queue_.empty() || (Outcome::DONE == outcome && this->delivered_ && !this->deferred_)) {
+            this->failures_ = 0;
+            continue;
           }
 
-          // pause for a minute
-          this->interval_timer_->expires_after(std::chrono::minutes(1));
+          // back off, exponentially with jitter, before the next round
+          auto const delay{this->backoff(this->failures_)};
+          ESP_LOGD(TAG, "back off %lld ms after %u failed rounds",
+                   std::chrono::duration_cast<std::chrono::milliseconds>(delay).count(), this->failures_);
+          this->interval_timer_->expires_after(delay);
           co_await this->interval_timer_->async_wait(asio::redirect_error(asio::use_awaitable, ec));
           if (ec == asio::error::operation_aborted) {
-            ESP_LOGD(TAG, "abort: interval timer %s", ec.message().c_str());
-            break;  // teardown
+            if (this->stopped_) {
+              ESP_LOGD(TAG, "abort: interval timer %s", ec.message().c_str());
+              break;  // teardown
+            }
+            ESP_LOGD(TAG, "back off cut short by urgent message");
           } else if (ec) {
             ESP_LOGW(TAG, "interval timer error: %s", ec.message().c_str());
           }
@@ -548,13 +1127,647 @@ void Component::setup() {
         // teardown cleanup
         this->queue_timer_.reset();
         this->interval_timer_.reset();
+        for (auto &relay : this->relays_) {
+          relay.idle_timer.reset();
+        }
         co_return;
       },
       asio::detached);
+
+  // run our io_context on its own task, if so configured, rather than poll it from loop
+  if (this->threaded_) {
+    this->work_.emplace(this->io_.get_executor());
+    auto const name{this->task_name_ + ".io"};
+    if (pdPASS != xTaskCreate(
+                      [](void *const component) {
+                        static_cast<Component *>(component)->io_.run();
+                        vTaskDelete(nullptr);
+                      },
+                      name.c_str(), IO_STACK, this, this->task_priority_, nullptr)) {
+      ESP_LOGE(TAG, "%s task create failed", name.c_str());
+      this->work_.reset();
+      this->threaded_ = false;  // poll from loop instead
+    }
+  }
 }
 
-bool Component::teardown() {
-  // undo setup
+template<typename Cancel> auto Component::deadline(Relay &relay, Stage const stage, Cancel cancel) {
+  return Deadline{this->io_, stage, this->timeouts_[static_cast<std::size_t>(stage)],
+                  this->latencies_[static_cast<std::size_t>(stage)], relay.deadlines, cancel};
+}
+
+asio::awaitable<Component::Outcome> Component::deliver() {
+  // relays that are up, in order of preference, or else the one to come up soonest
+  auto const now{std::chrono::steady_clock::now()};
+  std::vector<Relay *> relays;
+  for (auto &relay : this->relays_) {
+    if (relay.down <= now) {
+      relays.push_back(&relay);
+    }
+  }
+  if (relays.empty()) {
+    relays.push_back(&*std::ranges::min_element(this->relays_, {}, &Relay::down));
+  }
+
+  if (!this->shard_) {
+    // fail over to the next relay as soon as a session with one fails
+    for (auto *const relay : relays) {
+      auto const outcome{co_await this->lane(*relay)};
+      if (Outcome::FAILED != outcome || this->stopped_) {
+        co_return outcome;
+      }
+    }
+    co_return Outcome::FAILED;
+  }
+
+  // shard the queue across as many relays as it needs, with a session through each at once,
+  // and wait for them all. the round is done if any of them is.
+  relays.resize(std::min(relays.size(), std::max(this->queue_.size(), std::size_t{1})));
+  auto running{relays.size()};
+  auto outcome{Outcome::FAILED};
+  asio::steady_timer joined{this->io_, asio::steady_timer::time_point::max()};
+  for (auto *const relay : relays) {
+    asio::co_spawn(this->io_, this->lane(*relay),
+                   [&running, &outcome, &joined](std::exception_ptr const, Outcome const ended) {
+                     if (Outcome::STOPPED == ended || (Outcome::DONE == ended && Outcome::FAILED == outcome)) {
+                       outcome = ended;
+                     }
+                     if (!--running) {
+                       joined.cancel();
+                     }
+                   });
+  }
+  while (running) {
+    std::error_code ignored;
+    co_await joined.async_wait(asio::redirect_error(asio::use_awaitable, ignored));
+  }
+  co_return outcome;
+}
+
+asio::awaitable<Component::Outcome> Component::lane(Relay &relay) {
+  // sessions through relay, the next at once if the last was lost while idle
+  auto outcome{Outcome::LOST};
+  while (Outcome::LOST == outcome && !this->stopped_) {
+    outcome = co_await this->session(relay);
+  }
+  if (this->stopped_) {
+    co_return Outcome::STOPPED;
+  }
+  if (Outcome::FAILED == outcome) {
+    auto const delay{this->backoff(relay.failures)};
+    relay.down = std::chrono::steady_clock::now() + delay;
+    ESP_LOGW(TAG, "relay %s down for %lld ms after %u failed sessions", relay.server.c_str(),
+             std::chrono::duration_cast<std::chrono::milliseconds>(delay).count(), relay.failures);
+  } else {
+    relay.failures = 0;
+  }
+  co_return outcome;
+}
+
+asio::awaitable<Component::Outcome> Component::session(Relay &relay) {
+  if (Transport::SMTP != relay.transport) {
+    co_return co_await this->notify(relay);
+  }
+
+  // with a deadline for each stage that aborts it if it stalls
+  std::error_code ec;
+  auto const abandon{[&relay]() {
+    if (relay.stream) {
+      std::error_code ignored;
+      relay.stream->lowest_layer().shutdown(asio::socket_base::shutdown_both, ignored);
+      relay.stream->lowest_layer().cancel(ignored);
+    }
+  }};
+  auto outcome{Outcome::FAILED};
+  auto shutdown{false};
+  do {
+    relay.stream.emplace(co_await asio::this_coro::executor, this->ssl_);
+
+    relay.stream->set_verify_mode(this->cas_.empty() ? asio::ssl::verify_none : asio::ssl::verify_peer, ec);
+    if (ec) {
+      ESP_LOGW(TAG, "ssl stream set verify mode error: %s", ec.message().c_str());
+      break;
+    }
+    {
+      MbedTlsResult const result{mbedtls_ssl_set_hostname(
+          reinterpret_cast<mbedtls_ssl_context *>(relay.stream->native_handle()), relay.server.c_str())};
+      if (result.is_error()) {
+        ESP_LOGW(TAG, "ssl set hostname error: %s:", result.to_string().c_str());
+        break;
+      }
+    }
+    if (relay.session_cached) {
+      // offer the session cached from our last handshake for an abbreviated handshake
+      MbedTlsResult const result{mbedtls_ssl_set_session(
+          reinterpret_cast<mbedtls_ssl_context *>(relay.stream->native_handle()), &relay.session)};
+      if (result.is_error()) {
+        ESP_LOGW(TAG, "ssl set session error: %s", result.to_string().c_str());
+        relay.session_cached = false;
+      }
+    }
+
+    {
+      auto socket{co_await this->connect(relay)};
+      if (!socket) {
+        break;
+      }
+      relay.stream->next_layer() = std::move(*socket);
+    }
+
+    relay.stream->lowest_layer().non_blocking(true, ec);
+    if (ec) {
+      ESP_LOGW(TAG, "set non blocking error: %s", ec.message().c_str());
+      break;
+    }
+
+    // greeting_and_ehlo and ssl handshake ordered per this->starttls_
+    asio::streambuf buffer;
+    Capabilities capabilities{0};
+    if (this->starttls_) {
+      {
+        auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+        auto const reply{co_await greeting_and_ehlo(relay.stream->next_layer(), buffer, capabilities)};
+        if (!reply.is_positive_completion()) {
+          ESP_LOGW(TAG, "greeting and ehlo: %s", reply.text());
+          break;
+        }
+      }
+      {
+        static constexpr auto request{concat::array("STARTTLS", CRLF)};
+        auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+        auto const reply{co_await command(relay.stream->next_layer(), buffer, request)};
+        if (!reply.is_positive_completion()) {
+          ESP_LOGW(TAG, "request STARTTLS: %s", reply.text());
+          break;
+        }
+      }
+    }
+    {
+      auto const handshake_timepoint{std::chrono::steady_clock::now()};
+      auto const guard{this->deadline(relay, Stage::HANDSHAKE, abandon)};
+      relay.stream->next_layer().reset();
+#if 0
+      // the espressif/asio port of async_handshake is not asynchronous
+      // esphome will complain it takes too long (~500 > 30ms)
+      co_await relay.stream->async_handshake(asio::ssl::stream_base::client, asio::redirect_error(asio::use_awaitable, ec));
+#else
+      // co_await the equivalent performed by our worker
+      ec = co_await async_on_worker(this->worker_, [&relay]() {
+        std::error_code ec_;
+        relay.stream->lowest_layer().non_blocking(false, ec_);
+        if (!ec_) {
+          relay.stream->handshake(asio::ssl::stream_base::client, ec_);
+          relay.stream->lowest_layer().non_blocking(true);
+        }
+        return ec_;
+      });
+#endif
+      if (ec) {
+        ESP_LOGW(TAG, "handshake error: %s", ec.message().c_str());
+        relay.session_cached = false;  // in case it was the cause
+        break;
+      }
+      auto const handshake_duration{std::chrono::steady_clock::now() - handshake_timepoint};
+
+      // what was resumed, if anything, and this session, cached for our next handshake
+      mbedtls_ssl_session negotiated;
+      mbedtls_ssl_session_init(&negotiated);
+      MbedTlsResult const result{mbedtls_ssl_get_session(
+          reinterpret_cast<mbedtls_ssl_context *>(relay.stream->native_handle()), &negotiated)};
+      if (result.is_error()) {
+        ESP_LOGW(TAG, "ssl get session error: %s", result.to_string().c_str());
+      }
+      auto const offered{relay.session_cached};
+      relay.session_cached = !result.is_error();
+      ESP_LOGI(TAG, "handshake (%s) %lld ms, %zu bytes sent, %zu received",
+               offered ? resumed(relay.session, negotiated) ? "resumed" : "full, resumption declined" : "full",
+               std::chrono::duration_cast<std::chrono::milliseconds>(handshake_duration).count(),
+               relay.stream->next_layer().get_written(), relay.stream->next_layer().get_read());
+      mbedtls_ssl_session_free(&relay.session);
+      relay.session = negotiated;
+    }
+    shutdown = true;
+    if (!this->starttls_) {
+      auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+      auto const reply{co_await greeting_and_ehlo(*relay.stream, buffer, capabilities)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "greeting and ehlo: %s", reply.text());
+        break;
+      }
+    } else {
+      // capabilities before STARTTLS must be discarded (RFC 3207)
+      auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+      auto const reply{co_await ehlo(*relay.stream, buffer, capabilities)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "ehlo: %s", reply.text());
+        break;
+      }
+    }
+    ESP_LOGD(TAG, "capabilities: 0x%02x", capabilities);
+
+    // login, in one round trip if we can
+    if (capabilities & AUTH_PLAIN) {
+      static constexpr auto log{"AUTH PLAIN <redacted>"};
+      auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+      auto const reply{co_await command(*relay.stream, buffer, this->auth_plain_, log)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "command AUTH PLAIN: %s", reply.text());
+        break;
+      }
+    } else {
+      {
+        static constexpr auto request{concat::array("AUTH LOGIN", CRLF)};
+        auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+        auto const reply{co_await command(*relay.stream, buffer, request)};
+        if (!reply.is_positive_intermediate()) {
+          ESP_LOGW(TAG, "command AUTH LOGIN %s", reply.text());
+          break;
+        }
+      }
+      {
+        auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+        auto const reply{co_await command(*relay.stream, buffer, this->auth_login_username_)};
+        if (!reply.is_positive_intermediate()) {
+          ESP_LOGW(TAG, "command AUTH LOGIN username: %s", reply.text());
+          break;
+        }
+      }
+      {
+        static constexpr auto log{"<redacted>"};
+        auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+        auto const reply{co_await command(*relay.stream, buffer, this->auth_login_password_, log)};
+        if (!reply.is_positive_completion()) {
+          ESP_LOGW(TAG, "command AUTH LOGIN password: %s", reply.text());
+          break;
+        }
+      }
+    }
+
+    // send each message in the queue, highest class first, once each session, until it is empty.
+    // a message that fails for now goes to the back of its class for the next session
+    // so as not to block the rest. one that fails permanently, or too often, is dead-lettered.
+    // then, if idle_, keep the session open that long for more.
+    // concurrent sessions (through other relays) take turns to take messages from the queue.
+    Prebuilt const prebuilt{this->mail_from_command_, this->rcpt_to_command_, this->from_field_, this->to_field_,
+                            this->to_};
+    auto sent{true};
+    auto delivered{false};  // any message, in this session
+    auto const session{++this->sessions_};
+    auto idle_until{std::chrono::steady_clock::now() + this->idle_};
+    while (true) {
+      while (true) {
+        auto taken{this->take(session)};
+        if (!taken) {
+          break;
+        }
+        auto message{std::move(*taken)};
+        std::string const subject{1 < message.count ? std::format("{} ({} times)", message.subject, message.count)
+                                                    : message.subject};
+        auto const send_timepoint{std::chrono::steady_clock::now()};
+        auto const reply{co_await [&]() -> asio::awaitable<Reply> {
+          auto const guard{this->deadline(relay, Stage::DATA, abandon)};
+          co_return co_await send(*relay.stream, buffer, capabilities, prebuilt, message.to, subject, message.body,
+                                  message.producer.get());
+        }()};
+        idle_until = std::chrono::steady_clock::now() + this->idle_;
+        ESP_LOGD(TAG, "send %s %lld ms", capabilities & PIPELINING ? "pipelined" : "unpipelined",
+                 std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                       send_timepoint)
+                     .count());
+        auto const positive{reply.is_positive_completion()};
+        auto const negative{reply.is_negative_transient_completion() || reply.is_negative_permanent_completion()};
+        delivered = delivered || positive;
+        this->conclude(relay, std::move(message),
+                       positive                                   ? Verdict::DELIVERED
+                       : reply.is_negative_permanent_completion() ? Verdict::REFUSED
+                                                                  : Verdict::DEFERRED,
+                       reply.text());
+        if (!positive && !negative) {
+          sent = false;
+          break;  // the session failed with it
+        }
+        if (!positive) {
+          // abandon the failed mail transaction and go on to the next
+          static constexpr auto request{concat::array("RSET", CRLF)};
+          auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+          if (!(co_await command(*relay.stream, buffer, request)).is_positive_completion()) {
+            sent = false;
+            break;
+          }
+        }
+      }
+      if (!this->queue_.empty()) {
+        break;  // what is left will be tried in the next session
+      }
+      if (!sent || !this->idle_.count()) {
+        break;
+      }
+      ESP_LOGD(TAG, "%s session idle", relay.server.c_str());
+      relay.idle_timer->expires_at(idle_until);
+      co_await relay.idle_timer->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+      if (!ec) {
+        ESP_LOGD(TAG, "%s session idle timeout", relay.server.c_str());
+        break;
+      } else if (ec != asio::error::operation_aborted) {
+        ESP_LOGW(TAG, "idle timer error: %s", ec.message().c_str());
+        ec.clear();
+        break;
+      }
+      ec.clear();
+      if (this->stopped_) {
+        outcome = Outcome::STOPPED;
+        break;
+      }
+      if (this->queue_.empty()) {
+        continue;  // another session took what was queued
+      }
+      // the server may have closed our idle session. if so, reconnect at once if it took something,
+      // or else after the back off of the next round, lest one that closes each idle session is hammered.
+      static constexpr auto request{concat::array("RSET", CRLF)};
+      auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+      auto const reply{co_await command(*relay.stream, buffer, request)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGI(TAG, "%s session lost: %s", relay.server.c_str(), reply.text());
+        shutdown = false;
+        outcome = delivered ? Outcome::LOST : Outcome::DONE;
+        break;
+      }
+    }
+    if (Outcome::FAILED != outcome || !sent) {
+      break;
+    }
+    outcome = Outcome::DONE;
+
+    // quit session
+    {
+      static constexpr auto request{concat::array("QUIT", CRLF)};
+      auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+      auto const reply{co_await command(*relay.stream, buffer, request)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "command QUIT: %s", reply.text());
+        break;
+      }
+    }
+  } while (false);
+
+  // session/stream cleanup
+  if (relay.stream) {
+    if (shutdown) {
+      auto const guard{this->deadline(relay, Stage::SHUTDOWN, abandon)};
+      co_await relay.stream->async_shutdown(asio::redirect_error(asio::use_awaitable, ec));
+      if (ec) {
+        ESP_LOGW(TAG, "shutdown ssl stream error: %s", ec.message().c_str());
+      }
+    }
+    if (relay.stream->lowest_layer().is_open()) {
+      relay.stream->lowest_layer().close(ec);
+      if (ec) {
+        ESP_LOGW(TAG, "close socket error: %s", ec.message().c_str());
+      }
+    }
+    relay.stream.reset();
+  }
+  co_return outcome;
+}
+
+asio::awaitable<Component::Outcome> Component::notify(Relay &relay) {
+  // a session by a transport that takes each message whole, in a datagram, request or packet.
+  // as with SMTP, each message is tried once and what fails for now is left for the next session,
+  // but the session ends as soon as there is nothing more to send.
+  std::error_code ec;
+  std::optional<asio::ip::udp::socket> datagram;
+  std::optional<asio::ip::tcp::socket> socket;
+  auto const abandon{[&datagram, &socket]() {
+    std::error_code ignored;
+    if (datagram) {
+      datagram->cancel(ignored);
+    }
+    if (socket) {
+      socket->shutdown(asio::socket_base::shutdown_both, ignored);
+      socket->cancel(ignored);
+    }
+  }};
+  auto const name{TRANSPORT_NAMES[static_cast<std::size_t>(relay.transport)]};
+  auto outcome{Outcome::FAILED};
+  do {
+    if (Transport::SYSLOG == relay.transport) {
+      if (!co_await this->resolve(relay)) {
+        break;
+      }
+      // connected, so that we need not name the endpoint in each send
+      auto const &endpoint{relay.endpoints.front()};
+      datagram.emplace(co_await asio::this_coro::executor);
+      datagram->connect(asio::ip::udp::endpoint{endpoint.address(), endpoint.port()}, ec);
+      if (ec) {
+        ESP_LOGW(TAG, "syslog connect %s error: %s", endpoint.address().to_string().c_str(), ec.message().c_str());
+        break;
+      }
+      datagram->non_blocking(true, ec);
+    } else {
+      socket = co_await this->connect(relay);
+      if (!socket) {
+        break;
+      }
+      socket->non_blocking(true, ec);
+    }
+    if (ec) {
+      ESP_LOGW(TAG, "set non blocking error: %s", ec.message().c_str());
+      break;
+    }
+
+    asio::streambuf buffer;
+    if (Transport::MQTT == relay.transport) {
+      auto const client{std::format("{}-{}", this->task_name_, get_mac_address())};
+      auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+      auto const reply{co_await acknowledged(
+          *socket, mqtt_connect(client, this->username_, this->password_, MQTT_KEEP_ALIVE), MQTT_CONNACK)};
+      if (!reply.is_positive_completion()) {
+        ESP_LOGW(TAG, "mqtt connect: %s", reply.text());
+        break;
+      }
+    }
+
+    auto const session{++this->sessions_};
+    std::uint16_t packet{0};  // id, of the last PUBLISH
+    auto sent{true};
+    auto delivered{false};  // any message, in this session
+    auto close{false};      // of a webhook connection, by its server
+    while (!close) {
+      auto taken{this->take(session)};
+      if (!taken) {
+        break;
+      }
+      auto message{std::move(*taken)};
+      std::string const subject{1 < message.count ? std::format("{} ({} times)", message.subject, message.count)
+                                                  : message.subject};
+      // of a produced body, only what fits in a CHUNK
+      std::string body;
+      if (message.producer) {
+        message.producer->rewind();
+        body.resize(CHUNK);
+        body.resize(message.producer->produce(std::span<char>{body}));
+      } else {
+        body = message.body;
+      }
+      auto const priority{PRIORITY_NAMES[static_cast<std::size_t>(message.priority)]};
+      auto const send_timepoint{std::chrono::steady_clock::now()};
+      auto const reply{co_await [&]() -> asio::awaitable<Reply> {
+        auto const guard{this->deadline(relay, Stage::DATA, abandon)};
+        switch (relay.transport) {
+          case Transport::SYSLOG:
+            co_return co_await send_datagram(
+                *datagram, syslog_message(PRIORITY_SEVERITIES[static_cast<std::size_t>(message.priority)],
+                                          App.get_name(), this->task_name_, subject, body));
+          case Transport::WEBHOOK: {
+            auto const host{80 == relay.port ? relay.server : std::format("{}:{}", relay.server, relay.port)};
+            co_return co_await post(
+                *socket, buffer,
+                webhook_request(host, relay.path, notify_json(subject, body, message.to, priority)), close);
+          }
+          case Transport::MQTT:
+            if (!++packet) {
+              ++packet;  // 0 is not a packet id
+            }
+            co_return co_await acknowledged(
+                *socket, mqtt_publish(relay.path, notify_json(subject, body, message.to, priority), packet),
+                MQTT_PUBACK, packet);
+          default:
+            co_return Reply{-1, "unsupported transport"};
+        }
+      }()};
+      ESP_LOGD(TAG, "send %s %lld ms", name,
+               std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                     send_timepoint)
+                   .count());
+      auto const positive{reply.is_positive_completion()};
+      auto const negative{reply.is_negative_transient_completion() || reply.is_negative_permanent_completion()};
+      delivered = delivered || positive;
+      this->conclude(relay, std::move(message),
+                     positive                                   ? Verdict::DELIVERED
+                     : reply.is_negative_permanent_completion() ? Verdict::REFUSED
+                                                                : Verdict::DEFERRED,
+                     reply.text());
+      if (!positive && !negative) {
+        sent = false;
+        break;  // the session failed with it
+      }
+    }
+    if (!sent) {
+      break;
+    }
+    // a webhook server that closed the connection with more to send is reconnected to at once,
+    // but only if it took something, lest one that refuses each message and closes is hammered without back off
+    outcome = close && delivered && !this->queue_.empty() ? Outcome::LOST : Outcome::DONE;
+
+    if (Transport::MQTT == relay.transport) {
+      auto const guard{this->deadline(relay, Stage::COMMAND, abandon)};
+      co_await asio::async_write(*socket, asio::buffer(MQTT_DISCONNECT), asio::redirect_error(asio::use_awaitable, ec));
+      if (ec) {
+        ESP_LOGW(TAG, "mqtt disconnect error: %s", ec.message().c_str());
+      }
+    }
+  } while (false);
+
+  // socket cleanup
+  if (datagram && datagram->is_open()) {
+    datagram->close(ec);
+  }
+  if (socket && socket->is_open()) {
+    socket->shutdown(asio::socket_base::shutdown_both, ec);
+    socket->close(ec);
+    if (ec) {
+      ESP_LOGW(TAG, "close socket error: %s", ec.message().c_str());
+    }
+  }
+  co_return outcome;
+}
+
+asio::awaitable<bool> Component::resolve(Relay &relay) {
+  // resolve, unless we have recently (or cannot now but have before)
+  auto const resolve_timepoint{std::chrono::steady_clock::now()};
+  if (!relay.endpoints.empty() && resolve_timepoint - relay.resolved < this->resolve_ttl_) {
+    ++this->resolve_hits_;
+    co_return true;
+  }
+  ++this->resolve_misses_;
+  std::error_code ec;
+  asio::ip::tcp::resolver resolver{co_await asio::this_coro::executor};
+  asio::ip::tcp::resolver::results_type results;
+  {
+    auto const guard{this->deadline(relay, Stage::RESOLVE, [&resolver]() { resolver.cancel(); })};
+    results = co_await resolver.async_resolve(relay.server, std::to_string(relay.port),
+                                              asio::redirect_error(asio::use_awaitable, ec));
+  }
+  if (ec) {
+    ESP_LOGW(TAG, "resolve %s, port %u error: %s", relay.server.c_str(), relay.port, ec.message().c_str());
+    if (relay.endpoints.empty()) {
+      co_return false;
+    }
+    ESP_LOGW(TAG, "resolve %s: using %zu stale endpoints", relay.server.c_str(), relay.endpoints.size());
+    co_return true;
+  }
+  // keep the last good endpoint first, if it is still one of them
+  std::vector<asio::ip::tcp::endpoint> endpoints;
+  for (auto const &result : results) {
+    endpoints.push_back(result.endpoint());
+  }
+  if (relay.good) {
+    auto const good{std::ranges::find(endpoints, *relay.good)};
+    if (good != endpoints.end()) {
+      std::rotate(endpoints.begin(), good, good + 1);
+    }
+  }
+  relay.endpoints = std::move(endpoints);
+  relay.resolved = resolve_timepoint;
+  co_return true;
+}
+
+asio::awaitable<std::optional<asio::ip::tcp::socket>> Component::connect(Relay &relay) {
+  auto const resolve_timepoint{std::chrono::steady_clock::now()};
+  if (!co_await this->resolve(relay)) {
+    co_return std::nullopt;
+  }
+
+  // connect to the first endpoint to answer, starting with the last good one
+  auto const connect_timepoint{std::chrono::steady_clock::now()};
+  auto const race{std::make_shared<Race>(co_await asio::this_coro::executor)};
+  {
+    auto const guard{this->deadline(relay, Stage::CONNECT, [race]() { race->cancel(); })};
+    co_await run_race(race, relay.endpoints, CONNECT_STAGGER);
+  }
+  if (!race->winner) {
+    ESP_LOGW(TAG, "connect server %s, port %u error: %s", relay.server.c_str(), relay.port,
+             race->ec.message().c_str());
+    relay.good.reset();
+    relay.resolved = {};  // resolve again next time
+    co_return std::nullopt;
+  }
+  if (relay.good != race->endpoint) {
+    relay.good = race->endpoint;
+    auto const good{std::ranges::find(relay.endpoints, *relay.good)};
+    if (good != relay.endpoints.end()) {
+      std::rotate(relay.endpoints.begin(), good, good + 1);
+    }
+  }
+  // each write ends a command (or pipeline of them), after which we wait for the reply to it.
+  // Nagle would hold back a short write (such as the end of DATA) for the peer's delayed ACK of the last.
+  std::error_code ec;
+  race->winner->set_option(asio::ip::tcp::no_delay{true}, ec);
+  if (ec) {
+    ESP_LOGW(TAG, "no delay error: %s", ec.message().c_str());
+  }
+  // in us, as it may take less than a ms of a good endpoint (and of the cache)
+  auto const us{[](auto const duration) {
+    return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  }};
+  ESP_LOGI(TAG, "connect %s %lld us (resolve %lld us, cache %u hits, %u misses)",
+           race->endpoint.address().to_string().c_str(), us(std::chrono::steady_clock::now() - connect_timepoint),
+           us(connect_timepoint - resolve_timepoint), this->resolve_hits_, this->resolve_misses_);
+  co_return std::move(race->winner);
+}
+
+void Component::stop() {
+  this->stopped_ = true;
   if (this->queue_timer_) {
     auto const count{this->queue_timer_->cancel()};
     ESP_LOGD(TAG, "teardown: queue timer cancelled %zu operations", count);
@@ -563,10 +1776,28 @@ bool Component::teardown() {
     auto const count{this->interval_timer_->cancel()};
     ESP_LOGD(TAG, "teardown: interval timer cancelled %zu operations", count);
   }
-  if (this->stream_ && this->stream_->lowest_layer().is_open()) {
-    this->stream_->lowest_layer().cancel();
-    ESP_LOGD(TAG, "teardown: stream cancel");
+  for (auto &relay : this->relays_) {
+    if (relay.idle_timer) {
+      relay.idle_timer->cancel();
+    }
+    if (relay.stream && relay.stream->lowest_layer().is_open()) {
+      relay.stream->lowest_layer().cancel();
+      ESP_LOGD(TAG, "teardown: %s stream cancel", relay.server.c_str());
+    }
   }
+}
+
+bool Component::teardown() {
+  // undo setup
+  if (this->threaded_) {
+    // on our io_context task, which will finish when it runs out of work
+    if (this->work_) {
+      asio::post(this->io_, [this]() { this->stop(); });
+      this->work_.reset();
+    }
+    return this->io_.stopped();
+  }
+  this->stop();
   size_t sum{0};
   while (auto const addend{this->io_.poll()}) {
     sum += addend;
@@ -575,27 +1806,385 @@ bool Component::teardown() {
   return true;
 }
 
-void Component::enqueue(std::string const &subject, std::string const &body, std::string const &to) {
-  ESP_LOGD(TAG, "enqueue %s", subject.c_str());
-  this->queue_.emplace_back(subject, body, to);
-  this->queue_timer_->cancel();
+void Component::enqueue(std::string const &subject, std::string const &body, std::string const &to,
+                        Priority const priority) {
+  this->arrive(new Arrival{subject, body, to, nullptr, nullptr, priority});
+}
+
+void Component::enqueue(std::string const &subject, std::unique_ptr<Producer> producer, std::string const &to,
+                        Priority const priority) {
+  this->arrive(new Arrival{subject, {}, to, nullptr, std::move(producer), priority});
+}
+
+void Component::arrive(Arrival *const arrival) {
+  // hand over to our io_context, from any thread, without a lock.
+  // the first arrival since it last received them posts it to do so.
+  auto *head{this->arrivals_.load(std::memory_order_relaxed)};
+  do {
+    arrival->next = head;
+  } while (!this->arrivals_.compare_exchange_weak(head, arrival, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+  if (!head) {
+    asio::post(this->io_, [this]() { this->receive(); });
+  }
+}
+
+void Component::receive() {
+  // take all arrivals (newest first), restore their order and admit them
+  auto *arrival{this->arrivals_.exchange(nullptr, std::memory_order_acquire)};
+  Arrival *oldest{nullptr};
+  while (arrival) {
+    auto *const next{arrival->next};
+    arrival->next = oldest;
+    oldest = arrival;
+    arrival = next;
+  }
+  while (oldest) {
+    std::unique_ptr<Arrival> const admitted{oldest};
+    oldest = oldest->next;
+    this->admit(admitted->subject, admitted->body, admitted->to, std::move(admitted->producer), admitted->priority);
+  }
+}
+
+void Component::admit(std::string const &subject, std::string const &body, std::string const &to,
+                      std::unique_ptr<Producer> producer, Priority const priority) {
+  // messages being sent are not in the queue, and so are left alone.
+  // neither are those with a produced body, nor spooled ones: a spooled record keeps its body and has no count,
+  // so one coalesced in memory would be replayed after a reboot as it was first.
+  if (this->coalesce_ && !producer && !this->spool_) {
+    auto const message{
+        std::find_if(this->queue_.begin(), this->queue_.end(), [&subject, &to, priority](Message const &queued) {
+          return !queued.producer && queued.subject == subject && queued.to == to && queued.priority == priority;
+        })};
+    if (message != this->queue_.end()) {
+      message->body = body;
+      ++message->count;
+      ESP_LOGD(TAG, "enqueue %s (coalesced %u)", subject.c_str(), message->count);
+      return;
+    }
+  }
+  // one that could not survive a reboot, as the rest do, is refused rather than queued
+  if (this->spool_ && !producer && !Spool::fits(subject, body, to)) {
+    ESP_LOGW(TAG, "dead letter %s: %zu bytes, too large to spool", subject.c_str(),
+             subject.size() + body.size() + to.size());
+    this->publish_dead();
+    return;
+  }
+  ESP_LOGD(TAG, "enqueue %s (%s)", subject.c_str(), PRIORITY_NAMES[static_cast<std::size_t>(priority)]);
+  Message message{subject, body, to, 1u, {}};
+  message.producer = std::move(producer);
+  message.priority = priority;
+  if (message.producer) {
+    if (this->spool_) {
+      ESP_LOGD(TAG, "%s has a produced body, not spooled", subject.c_str());
+    }
+  } else if (this->spool_) {
+    if (auto const record{this->spool_->append(subject, body, to)}) {
+      message.records.push_back(*record);
+    }
+  }
+  this->push(std::move(message));
+}
+
+void Component::push(Message &&message) {
+  if (this->capacity_ <= this->queue_.size() + this->flying_) {
+    // drop from the lowest class, of the queue and message, the oldest or newest of it
+    auto victim{this->queue_.end()};
+    if (!this->queue_.empty()) {
+      auto const lowest{this->queue_.back().priority};
+      auto const oldest{std::ranges::find(this->queue_, lowest, &Message::priority)};
+      if (lowest < message.priority) {
+        victim = this->drop_ == Drop::NEWEST ? std::prev(this->queue_.end()) : oldest;
+      } else if (lowest == message.priority && this->drop_ == Drop::OLDEST) {
+        victim = oldest;
+      }
+    }
+    ++this->dropped_;
+    auto &dropped{victim == this->queue_.end() ? message : *victim};
+    ESP_LOGW(TAG, "queue full, drop %s (%zu dropped)", dropped.subject.c_str(), this->dropped_);
+    if (this->spool_) {
+      for (auto const record : dropped.records) {
+        this->spool_->ack(record);
+      }
+    }
+    if (&dropped == &message) {
+      return;
+    }
+    this->queue_.erase(victim);
+  }
+  auto const urgent{Priority::URGENT == message.priority};
+  this->insert(std::move(message));
+  this->publish_queue();
+  if (this->queue_timer_) {
+    this->queue_timer_->cancel();
+  }
+  if (urgent && this->interval_timer_) {
+    this->interval_timer_->cancel();  // cut short a digest window or back off
+  }
+  for (auto &relay : this->relays_) {
+    if (relay.idle_timer) {
+      relay.idle_timer->cancel();
+    }
+  }
+}
+
+void Component::insert(Message &&message) {
+  // after all messages of its class or higher, before any lower
+  auto const position{std::ranges::find_if(
+      this->queue_, [priority = message.priority](Message const &queued) { return queued.priority < priority; })};
+  this->queue_.insert(position, std::move(message));
+}
+
+void Component::retire(Message &message) {
+  // the message, taken from the queue, is done with, one way or another
+  if (this->spool_) {
+    for (auto const record : message.records) {
+      this->spool_->ack(record);
+    }
+  }
+  this->publish_queue();
+}
+
+std::optional<Component::Message> Component::take(unsigned const session) {
+  // the first message not yet tried by this session, if any
+  auto const next{
+      std::ranges::find_if(this->queue_, [session](Message const &queued) { return queued.session != session; })};
+  if (next == this->queue_.end()) {
+    return std::nullopt;
+  }
+  // enqueue will leave the message alone, out of the queue, while we are sending it
+  std::optional<Message> message{std::move(*next)};
+  this->queue_.erase(next);
+  ++this->flying_;
+  message->session = session;
+  ++message->attempts;
+  return message;
+}
+
+void Component::conclude(Relay &relay, Message &&message, Verdict const verdict, char const *const reason) {
+  // the attempt to send a message, taken from the queue, is over
+  --this->flying_;
+  if (Verdict::DELIVERED == verdict) {
+    auto const latency{std::chrono::steady_clock::now() - message.enqueued};
+    record(this->deliveries_[static_cast<std::size_t>(message.priority)], latency);
+    record(relay.deliveries, latency);
+    ++this->delivered_;
+    this->retire(message);
+  } else if (Verdict::REFUSED == verdict || this->retry_attempts_ <= message.attempts) {
+    ESP_LOGW(TAG, "dead letter %s after %u attempts: %s", message.subject.c_str(), message.attempts, reason);
+    this->publish_dead();
+    this->retire(message);
+  } else {
+    ESP_LOGI(TAG, "retry %s after attempt %u", message.subject.c_str(), message.attempts);
+    ++this->deferred_;
+    this->insert(std::move(message));
+  }
+}
+
+void Component::publish_dead() {
+  // count one more dead letter and, from our io_context, publish on the main loop
+  ++this->dead_;
+  if (this->dead_sensor_) {
+    this->defer([this, dead = static_cast<float>(this->dead_)]() { this->dead_sensor_->publish_state(dead); });
+  }
+}
+
+void Component::publish_queue() {
+  // from our io_context, publish on the main loop
+  auto const depth{static_cast<float>(this->queue_.size() + this->flying_)};
+  auto const now{std::chrono::steady_clock::now()};
+  auto oldest{now};
+  for (auto const &message : this->queue_) {
+    oldest = std::min(oldest, message.enqueued);
+  }
+  auto const age{static_cast<float>(std::chrono::duration_cast<std::chrono::seconds>(now - oldest).count())};
+  this->defer([this, depth, age]() {
+    if (this->depth_sensor_) {
+      this->depth_sensor_->publish_state(depth);
+    }
+    if (this->age_sensor_) {
+      this->age_sensor_->publish_state(age);
+    }
+  });
+}
+
+void Component::log_latencies() {
+  for (std::size_t stage{0}; stage < STAGES; ++stage) {
+    auto const text{describe(this->latencies_[stage])};
+    if (!text.empty()) {
+      ESP_LOGD(TAG, "%s latency%s", STAGE_NAMES[stage], text.c_str());
+    }
+  }
+  for (std::size_t priority{0}; priority < PRIORITIES; ++priority) {
+    auto const text{describe(this->deliveries_[priority])};
+    if (!text.empty()) {
+      ESP_LOGD(TAG, "%s delivery latency%s", PRIORITY_NAMES[priority], text.c_str());
+    }
+  }
+  for (auto const &relay : this->relays_) {
+    auto const text{describe(relay.deliveries)};
+    if (!text.empty()) {
+      ESP_LOGD(TAG, "%s %s delivery latency%s", TRANSPORT_NAMES[static_cast<std::size_t>(relay.transport)],
+               relay.server.c_str(), text.c_str());
+    }
+  }
 }
 
-void Component::loop() { this->io_.poll_one(); }
+asio::steady_timer::duration Component::backoff(unsigned &failures) {
+  // double the delay for each consecutive failure, up to the maximum,
+  // then choose at random from its upper half so that many clients do not retry in step.
+  auto delay{this->retry_initial_};
+  for (auto doublings{failures}; doublings && delay < this->retry_maximum_; --doublings) {
+    delay *= 2;
+  }
+  delay = std::min(delay, this->retry_maximum_);
+  ++failures;
+  auto const half{std::chrono::duration_cast<std::chrono::milliseconds>(delay) / 2};
+  std::chrono::milliseconds const jitter{random_uint32() % (static_cast<uint32_t>(half.count()) + 1)};
+  return half + jitter;
+}
 
-void Component::set_server(std::string const &value) { this->server_ = value; }
-void Component::set_port(uint16_t const value) { this->port_ = value; }
-void Component::set_username(std::string const &value) { this->username_ = value; }
+void Component::fold() {
+  // fold the queue into one digest message for each recipient and class, in order.
+  // a digest left from a failed round is folded into the new one as its listing, not nested in it,
+  // and the new one is as many attempts along as the most tried of what it holds.
+  if (this->queue_.size() < 2) {
+    return;
+  }
+  std::deque<Message> digests;
+  std::deque<Message> kept;  // urgent messages and produced bodies, as they are
+  for (auto &message : this->queue_) {
+    if (message.producer || Priority::URGENT == message.priority) {
+      kept.push_back(std::move(message));
+      continue;
+    }
+    auto digest{std::ranges::find_if(digests, [&message](Message const &folded) {
+      return folded.to == message.to && folded.priority == message.priority;
+    })};
+    if (digest == digests.end()) {
+      digest = digests.insert(digests.end(), Message{{}, {}, message.to, 0u, {}});
+      digest->priority = message.priority;
+    } else {
+      digest->body += CRLF;
+    }
+    digest->enqueued = std::min(digest->enqueued, message.enqueued);
+    digest->attempts = std::max(digest->attempts, message.attempts);
+    digest->records.insert(digest->records.end(), message.records.begin(), message.records.end());
+    if (message.folded) {
+      digest->count += message.folded;
+      digest->body += message.body;
+    } else {
+      digest->count += message.count;
+      digest->body += 1 < message.count ? std::format("{} ({} times){}", message.subject, message.count, CRLF)
+                                        : std::format("{}{}", message.subject, CRLF);
+      if (!message.body.empty()) {
+        digest->body += message.body;
+        digest->body += CRLF;
+      }
+    }
+    std::string{}.swap(message.body);  // release as we go
+  }
+  for (auto &digest : digests) {
+    digest.subject = std::format("digest of {} messages", digest.count);
+    digest.folded = digest.count;
+    digest.count = 1;
+  }
+  ESP_LOGD(TAG, "fold %zu messages into %zu digests", this->queue_.size() - kept.size(), digests.size());
+  this->queue_.swap(digests);
+  for (auto &message : kept) {
+    this->insert(std::move(message));
+  }
+  this->publish_queue();
+}
+
+void Component::loop() {
+  if (!this->threaded_) {
+    this->io_.poll_one();
+  }
+}
+
+void Component::add_relay(std::string const &server, uint16_t const port, Transport const transport,
+                          std::string const &path) {
+  this->relays_.emplace_back(server, port, transport, path);
+}
+void Component::set_shard(bool const value) { this->shard_ = value; }
+void Component::set_username(std::string const &value) {
+  this->username_ = value;
+  this->encode_credentials();
+}
 void Component::set_password(std::string const &value) {
   this->password_ = value;
   if (!esp_flash_encryption_enabled()) {
     ESP_LOGW(TAG, "flash encryption disabled");
   }
+  this->encode_credentials();
+}
+
+void Component::encode_credentials() {
+  // once, for each AUTH mechanism, so that a session need not
+  for (auto const result : {
+           base64_encode("AUTH PLAIN ", '\0' + this->username_ + '\0' + this->password_, this->auth_plain_),
+           base64_encode({}, this->username_, this->auth_login_username_),
+           base64_encode({}, this->password_, this->auth_login_password_),
+       }) {
+    if (result.is_error()) {
+      ESP_LOGE(TAG, "base64_encode: %s", result.to_string().c_str());
+    }
+  }
+}
+void Component::set_from(std::string const &value) {
+  this->from_ = value;
+  this->mail_from_command_ = concat::string("MAIL FROM:<", this->from_, concat::view(CLOSE));
+  this->from_field_ = concat::string("From: ", this->from_, CRLF);
+}
+void Component::set_to(std::string const &value) {
+  this->to_ = value;
+  this->rcpt_to_command_ = concat::string(concat::view(RCPT_TO), this->to_, concat::view(CLOSE));
+  this->to_field_ = concat::string(concat::view(TO_FIELD), this->to_, CRLF);
 }
-void Component::set_from(std::string const &value) { this->from_ = value; }
-void Component::set_to(std::string const &value) { this->to_ = value; }
 void Component::set_starttls(bool const value) { this->starttls_ = value; }
 void Component::set_cas(std::string const &value) { this->cas_ = value; }
+void Component::set_idle(int64_t const value) {
+  this->idle_ = asio::steady_timer::duration(std::chrono::nanoseconds(value));
+}
+void Component::set_capacity(size_t const value) { this->capacity_ = value; }
+void Component::set_drop(Drop const value) { this->drop_ = value; }
+void Component::set_coalesce(bool const value) { this->coalesce_ = value; }
+void Component::set_digest(int64_t const value) {
+  this->digest_ = asio::steady_timer::duration(std::chrono::nanoseconds(value));
+}
+void Component::set_spool(std::string const &value) {
+  // replay now, before anything new is queued
+  this->spool_.emplace(value);
+  auto const opened{this->spool_->open(
+      [this](Spool::Record const record, std::string_view const subject, std::string_view const body,
+             std::string_view const to) {
+        ESP_LOGD(TAG, "replay %.*s", static_cast<int>(subject.size()), subject.data());
+        this->push(Message{std::string{subject}, std::string{body}, std::string{to}, 1u, {record}});
+      })};
+  if (!opened) {
+    this->spool_.reset();
+  }
+}
+void Component::set_retry_initial(int64_t const value) {
+  this->retry_initial_ = asio::steady_timer::duration(std::chrono::nanoseconds(value));
+}
+void Component::set_retry_maximum(int64_t const value) {
+  this->retry_maximum_ = asio::steady_timer::duration(std::chrono::nanoseconds(value));
+}
+void Component::set_retry_attempts(unsigned const value) { this->retry_attempts_ = value; }
+void Component::set_task_name(std::string const &value) { this->task_name_ = value; }
+void Component::set_task_priority(unsigned const value) { this->task_priority_ = value; }
+void Component::set_threaded(bool const value) { this->threaded_ = value; }
+void Component::set_timeout(Stage const stage, int64_t const value) {
+  this->timeouts_[static_cast<std::size_t>(stage)] = asio::steady_timer::duration(std::chrono::nanoseconds(value));
+}
+void Component::set_resolve_ttl(int64_t const value) {
+  this->resolve_ttl_ = asio::steady_timer::duration(std::chrono::nanoseconds(value));
+}
+void Component::set_depth(sensor::Sensor *const value) { this->depth_sensor_ = value; }
+void Component::set_age(sensor::Sensor *const value) { this->age_sensor_ = value; }
+void Component::set_dead(sensor::Sensor *const value) { this->dead_sensor_ = value; }
 
 }  // namespace smtp_
 }  // namespace esphome
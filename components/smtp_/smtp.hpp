@@ -1,8 +1,16 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <deque>
+#include <memory>
 #include <optional>
 #include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -12,25 +20,107 @@
 #pragma GCC diagnostic ignored "-Wsuggest-override"
 #pragma GCC diagnostic ignored "-Wc++11-compat"
 #pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#include <asio/awaitable.hpp>
+#include <asio/executor_work_guard.hpp>
 #include <asio/io_context.hpp>
 #include <asio/ip/tcp.hpp>
 #include <asio/ssl/stream.hpp>
 #include <asio/steady_timer.hpp>
 #pragma GCC diagnostic pop
 
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#include "mbedtls/ssl.h"
+#pragma GCC diagnostic pop
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
 #pragma GCC diagnostic ignored "-Wsign-conversion"
 #include "esphome/core/component.h"
 #include "esphome/core/automation.h"
+#include "esphome/components/sensor/sensor.h"
 #pragma GCC diagnostic pop
 
+#include "multipart.hpp"
+#include "producer.hpp"
+#include "spool.hpp"
+#include "worker.hpp"
+
 namespace esphome {
 namespace smtp_ {
 
+// which message to drop when the queue is full
+enum class Drop : std::uint8_t {
+  OLDEST,
+  NEWEST,
+};
+
+// class of a message. the queue is drained from the highest, and dropped from the lowest, first.
+enum class Priority : std::uint8_t {
+  LOW,
+  NORMAL,
+  URGENT,  // not folded, and cuts short a digest window or back off
+};
+constexpr std::size_t PRIORITIES{static_cast<std::size_t>(Priority::URGENT) + 1};
+
+// how a relay takes messages
+enum class Transport : std::uint8_t {
+  SMTP,
+  SYSLOG,   // an RFC 5424 message in a UDP datagram, unacknowledged
+  WEBHOOK,  // an HTTP/1.1 POST of a JSON object
+  MQTT,     // an MQTT 3.1.1 PUBLISH of a JSON object, at QoS 1
+};
+
+// stages of a session, each with its own deadline
+enum class Stage : std::uint8_t {
+  RESOLVE,
+  CONNECT,
+  HANDSHAKE,
+  COMMAND,
+  DATA,
+  SHUTDOWN,
+};
+constexpr std::size_t STAGES{static_cast<std::size_t>(Stage::SHUTDOWN) + 1};
+
+// counts of latencies in power of two millisecond buckets: <1, <2, <4 ... and the rest in the last
+using Histogram = std::array<std::uint16_t, 16>;
+
+// a TCP socket that counts the bytes read from and written to it synchronously. under a TLS stream,
+// those are the bytes of its handshake (which blocks, on our worker) through its BIO.
+class CountingSocket : public asio::ip::tcp::socket {
+ public:
+  using asio::ip::tcp::socket::socket;
+  CountingSocket &operator=(asio::ip::tcp::socket &&socket) {
+    asio::ip::tcp::socket::operator=(std::move(socket));
+    return *this;
+  }
+
+  template<typename Buffers> std::size_t read_some(Buffers const &buffers, std::error_code &ec) {
+    auto const size{asio::ip::tcp::socket::read_some(buffers, ec)};
+    this->read_ += size;
+    return size;
+  }
+  template<typename Buffers> std::size_t write_some(Buffers const &buffers, std::error_code &ec) {
+    auto const size{asio::ip::tcp::socket::write_some(buffers, ec)};
+    this->written_ += size;
+    return size;
+  }
+
+  // since the last reset
+  std::size_t get_read() const { return this->read_; }
+  std::size_t get_written() const { return this->written_; }
+  void reset() { this->read_ = this->written_ = 0; }
+
+ private:
+  std::size_t read_{0};
+  std::size_t written_{0};
+};
+
 class Component : public esphome::Component {
  public:
   explicit Component();
+  ~Component();
 
   void dump_config() override;
 
@@ -41,41 +131,189 @@ class Component : public esphome::Component {
   void loop() override;
 
   // configuration setters
-  void set_server(std::string const &value);
-  void set_port(uint16_t value);
+  void add_relay(std::string const &server, uint16_t port, Transport transport = Transport::SMTP,
+                 std::string const &path = "");
+  void set_shard(bool value);
   void set_username(std::string const &value);
   void set_password(std::string const &value);
   void set_from(std::string const &value);
   void set_to(std::string const &value);
   void set_starttls(bool value);
   void set_cas(std::string const &value);
+  void set_idle(int64_t value);
+  void set_capacity(size_t value);
+  void set_drop(Drop value);
+  void set_coalesce(bool value);
+  void set_digest(int64_t value);
+  void set_spool(std::string const &value);
+  void set_retry_initial(int64_t value);
+  void set_retry_maximum(int64_t value);
+  void set_retry_attempts(unsigned value);
+  void set_timeout(Stage stage, int64_t value);
+  void set_resolve_ttl(int64_t value);
+  void set_task_name(std::string const &value);
+  void set_task_priority(unsigned value);
+  void set_threaded(bool value);
+  void set_depth(sensor::Sensor *value);
+  void set_age(sensor::Sensor *value);
+  void set_dead(sensor::Sensor *value);
 
-  void enqueue(std::string const &subject, std::string const &body, std::string const &to = "");
+  // from any thread
+  void enqueue(std::string const &subject, std::string const &body, std::string const &to = "",
+               Priority priority = Priority::NORMAL);
+  // ^ with the body from producer, which is called on our io_context. it is not spooled, coalesced or folded.
+  void enqueue(std::string const &subject, std::unique_ptr<Producer> producer, std::string const &to = "",
+               Priority priority = Priority::NORMAL);
 
  private:
+  void encode_credentials();
   struct Message {
     std::string subject;
     std::string body;
     std::string to;
+    unsigned count;                      // of messages coalesced into this one
+    std::vector<Spool::Record> records;  // that spool this (and any folded into it)
+    unsigned attempts{0};                // to send this
+    unsigned session{0};                 // of the last attempt
+    std::chrono::steady_clock::time_point enqueued{std::chrono::steady_clock::now()};
+    std::unique_ptr<Producer> producer{};  // of the body, in place of body
+    Priority priority{Priority::NORMAL};   // spooled messages are replayed as NORMAL
+    unsigned folded{0};                    // messages folded into this digest (0 if it is not one)
+  };
+
+  // a server to relay messages through, and what we know of it
+  struct Relay {
+    explicit Relay(std::string const &server_name, uint16_t server_port, Transport relay_transport,
+                   std::string const &relay_path);
+    ~Relay();
+    Relay(Relay const &) = delete;
+    Relay &operator=(Relay const &) = delete;
+
+    std::string const server;
+    uint16_t const port;
+    Transport const transport;
+    std::string const path;                          // webhook request target or MQTT topic
+    std::vector<asio::ip::tcp::endpoint> endpoints;  // of server, last good first
+    std::chrono::steady_clock::time_point resolved;  // endpoints
+    std::optional<asio::ip::tcp::endpoint> good;     // endpoint we last connected to
+    unsigned failures{0};                            // of sessions, consecutively
+    std::chrono::steady_clock::time_point down;      // until, after a failed session
+    unsigned deadlines{0};                           // passed, so that a stale one does not cancel the next stage
+    std::optional<asio::steady_timer> idle_timer;    // of an idle session
+    std::optional<asio::ssl::stream<CountingSocket>> stream;
+    Histogram deliveries{};  // latency from enqueue to delivery through this relay
+
+    // TLS session (or session ticket) from our last handshake, offered for resumption by the next
+    mbedtls_ssl_session session;
+    bool session_cached{false};
+  };
+
+  // how a session ended
+  enum class Outcome : std::uint8_t {
+    DONE,     // with what it could send
+    FAILED,   // with the relay
+    LOST,     // idle, by the relay. to be resumed at once
+    STOPPED,  // by teardown
+  };
+
+  // what became of an attempt to send a message
+  enum class Verdict : std::uint8_t {
+    DELIVERED,
+    DEFERRED,  // to be retried, unless it has been too often
+    REFUSED,   // for good. to be dead-lettered
+  };
+
+  // a message handed over by enqueue, in a lock-free stack of them
+  struct Arrival {
+    std::string subject;
+    std::string body;
+    std::string to;
+    Arrival *next;
+    std::unique_ptr<Producer> producer;
+    Priority priority;
   };
 
+  void arrive(Arrival *arrival);
+  void receive();
+  void admit(std::string const &subject, std::string const &body, std::string const &to,
+             std::unique_ptr<Producer> producer, Priority priority);
+  void push(Message &&message);
+  void insert(Message &&message);
+  void fold();
+  void retire(Message &message);
+  std::optional<Message> take(unsigned session);
+  void conclude(Relay &relay, Message &&message, Verdict verdict, char const *reason);
+  void publish_dead();
+  void publish_queue();
+  void log_latencies();
+  void stop();
+  asio::steady_timer::duration backoff(unsigned &failures);
+  asio::awaitable<Outcome> deliver();
+  asio::awaitable<Outcome> lane(Relay &relay);
+  asio::awaitable<Outcome> session(Relay &relay);
+  asio::awaitable<Outcome> notify(Relay &relay);
+  asio::awaitable<bool> resolve(Relay &relay);
+  asio::awaitable<std::optional<asio::ip::tcp::socket>> connect(Relay &relay);
+  template<typename Cancel> auto deadline(Relay &relay, Stage stage, Cancel cancel);
+
   // configuration
-  std::string server_;
-  uint16_t port_;
+  std::deque<Relay> relays_;  // in order of preference
+  bool shard_;                // the queue across relays, rather than fail over from one to the next
   std::string username_;
   std::string password_;
+  std::string auth_plain_;           // AUTH PLAIN command with initial response
+  std::string auth_login_username_;  // AUTH LOGIN username response
+  std::string auth_login_password_;  // AUTH LOGIN password response
   std::string from_;
   std::string to_;
+  std::string mail_from_command_;  // prebuilt from from_, with rcpt_to_command_, from_field_ and to_field_ from to_
+  std::string rcpt_to_command_;
+  std::string from_field_;
+  std::string to_field_;
   bool starttls_;
   std::string cas_;
+  asio::steady_timer::duration idle_;    // to keep a session open for more messages
+  size_t capacity_;                      // of queue_
+  Drop drop_;                            // when queue_ is full
+  bool coalesce_;                        // messages with the same subject and recipient
+  asio::steady_timer::duration digest_;  // window to collect messages to fold into one
+
+  std::optional<Spool> spool_;                                 // of queue_, if configured
+  asio::steady_timer::duration retry_initial_;                 // backoff after a failed session
+  asio::steady_timer::duration retry_maximum_;                 // backoff
+  unsigned retry_attempts_;                                    // to send a message before it is dead-lettered
+  std::array<asio::steady_timer::duration, STAGES> timeouts_;  // of each stage, if not zero
+  asio::steady_timer::duration resolve_ttl_;                   // to trust the endpoints of a relay for
+  sensor::Sensor *depth_sensor_;
+  sensor::Sensor *age_sensor_;
+  sensor::Sensor *dead_sensor_;
+  std::string task_name_;   // of worker_ (and io_ task)
+  unsigned task_priority_;  // of worker_ (and io_ task)
+  bool threaded_;           // run io_ on its own task
 
   asio::io_context io_;
+  std::optional<asio::executor_work_guard<asio::io_context::executor_type>> work_;  // keeps a threaded io_ running
+  std::atomic<Arrival *> arrivals_;                                                 // newest first
   std::deque<Message> queue_;
+  size_t flying_;      // messages, taken from queue_ to be sent
+  size_t dropped_;     // messages, because queue_ was full
+  size_t dead_;        // messages, dead-lettered
+  unsigned sessions_;  // started
+  unsigned failures_;  // of rounds of sessions, consecutively, to empty queue_
+  unsigned delivered_;  // messages, in this round of sessions
+  unsigned deferred_;   // messages, in this round of sessions, to be retried in another
+  bool stopped_;       // by teardown
+
+  unsigned resolve_hits_;    // sessions that used the endpoints of a relay as cached
+  unsigned resolve_misses_;  // sessions that resolved the server of a relay
+
+  std::array<Histogram, STAGES> latencies_;       // of each stage
+  std::array<Histogram, PRIORITIES> deliveries_;  // latency from enqueue to delivery of each class
 
   std::optional<asio::steady_timer> queue_timer_;
   std::optional<asio::steady_timer> interval_timer_;
+  Worker worker_;
   asio::ssl::context ssl_;
-  std::optional<asio::ssl::stream<asio::ip::tcp::socket>> stream_;
 };
 
 // Action for sending emails
@@ -86,16 +324,38 @@ template<typename... Ts> class Action : public esphome::Action<Ts...> {
   TEMPLATABLE_VALUE(std::string, subject)
   TEMPLATABLE_VALUE(std::string, body)
   TEMPLATABLE_VALUE(std::string, to)
+  TEMPLATABLE_VALUE(Priority, priority)
+
+  // attach content from generator, as a file of this name and MIME type, to each message
+  void add_attachment(std::string const &name, std::string const &type, Multipart::Generator const &generator) {
+    this->attachments_.push_back({name, type, generator});
+  }
 
   void play(Ts... x) override {
     auto const subject{this->subject_.value(x...)};
     auto const body{this->body_.optional_value(x...).value_or("")};
     auto const to{this->to_.optional_value(x...).value_or("")};
-    this->parent_->enqueue(subject, body, to);
+    auto const priority{this->priority_.optional_value(x...).value_or(Priority::NORMAL)};
+    if (this->attachments_.empty()) {
+      this->parent_->enqueue(subject, body, to, priority);
+      return;
+    }
+    auto multipart{std::make_unique<Multipart>(body)};
+    for (auto const &attachment : this->attachments_) {
+      multipart->attach(attachment.name, attachment.type, attachment.generator);
+    }
+    this->parent_->enqueue(subject, std::move(multipart), to, priority);
   }
 
  protected:
+  struct Attachment {
+    std::string name;
+    std::string type;
+    Multipart::Generator generator;
+  };
+
   Component *parent_;
+  std::vector<Attachment> attachments_{};
 };
 
 }  // namespace smtp_
@@ -0,0 +1,334 @@
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wpedantic"
+#pragma GCC diagnostic error "-Wconversion"
+#pragma GCC diagnostic error "-Wsign-conversion"
+#pragma GCC diagnostic error "-Wold-style-cast"
+#pragma GCC diagnostic error "-Wshadow"
+#pragma GCC diagnostic error "-Wnull-dereference"
+#pragma GCC diagnostic error "-Wformat=2"
+#pragma GCC diagnostic error "-Wsuggest-override"
+#pragma GCC diagnostic error "-Wzero-as-null-pointer-constant"
+
+#include "spool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace smtp_ {
+
+namespace {
+
+constexpr auto TAG{"smtp_.spool"};
+
+constexpr std::size_t SECTOR{4096};  // flash erase size
+#ifndef USE_ESP_IDF
+constexpr std::size_t FILE_SIZE{16 * SECTOR};
+#endif
+
+constexpr std::uint8_t ERASED{0xFF};
+constexpr std::uint8_t MAGIC{0xA5};
+constexpr std::uint8_t PENDING{0xFF};  // as written
+constexpr std::uint8_t ACKED{0x00};    // by clearing bits
+
+// a record is a Header followed by subject, body and to, padded to alignment
+struct Header {
+  std::uint32_t crc;  // of what follows, up to magic, and the payload
+  std::uint32_t sequence;
+  std::uint16_t subject_size;
+  std::uint16_t body_size;
+  std::uint16_t to_size;
+  std::uint8_t magic;
+  std::uint8_t state;
+};
+static_assert(sizeof(Header) == 16);
+
+constexpr std::size_t ALIGNMENT{4};
+
+constexpr std::size_t aligned(std::size_t const size) { return (size + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1); }
+
+constexpr std::size_t payload_size(Header const &header) {
+  return std::size_t{header.subject_size} + header.body_size + header.to_size;
+}
+
+// CRC-32 (IEEE 802.3) of data, continued from crc
+std::uint32_t crc32(std::uint32_t crc, void const *const data, std::size_t size) {
+  crc = ~crc;
+  for (auto const *byte{static_cast<std::uint8_t const *>(data)}; size--; ++byte) {
+    crc ^= std::uint32_t{*byte};
+    for (auto bit{0}; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+std::uint32_t crc32(Header const &header, std::string_view const payload) {
+  auto const *const begin{reinterpret_cast<std::uint8_t const *>(&header)};
+  auto const crc{crc32(0, begin + offsetof(Header, sequence), offsetof(Header, magic) - offsetof(Header, sequence))};
+  return crc32(crc, payload.data(), payload.size());
+}
+
+}  // namespace
+
+Spool::Spool(std::string label)
+    : label_{std::move(label)},
+#ifdef USE_ESP_IDF
+      partition_{nullptr},
+#else
+      file_{nullptr},
+#endif
+      size_{0},
+      pending_{},
+      sector_{0},
+      offset_{0},
+      sequence_{0} {
+}
+
+Spool::~Spool() {
+#ifndef USE_ESP_IDF
+  if (this->file_) {
+    std::fclose(this->file_);
+  }
+#endif
+}
+
+bool Spool::read(std::size_t const offset, void *const data, std::size_t const size) {
+#ifdef USE_ESP_IDF
+  auto const error{esp_partition_read(this->partition_, offset, data, size)};
+  if (ESP_OK != error) {
+    ESP_LOGW(TAG, "read %zu bytes at %zu error: %s", size, offset, esp_err_to_name(error));
+    return false;
+  }
+#else
+  if (std::fseek(this->file_, static_cast<long>(offset), SEEK_SET) ||
+      size != std::fread(data, 1, size, this->file_)) {
+    ESP_LOGW(TAG, "read %zu bytes at %zu error", size, offset);
+    return false;
+  }
+#endif
+  return true;
+}
+
+bool Spool::write(std::size_t const offset, void const *const data, std::size_t const size) {
+#ifdef USE_ESP_IDF
+  auto const error{esp_partition_write(this->partition_, offset, data, size)};
+  if (ESP_OK != error) {
+    ESP_LOGW(TAG, "write %zu bytes at %zu error: %s", size, offset, esp_err_to_name(error));
+    return false;
+  }
+#else
+  if (std::fseek(this->file_, static_cast<long>(offset), SEEK_SET) ||
+      size != std::fwrite(data, 1, size, this->file_) || std::fflush(this->file_)) {
+    ESP_LOGW(TAG, "write %zu bytes at %zu error", size, offset);
+    return false;
+  }
+#endif
+  return true;
+}
+
+bool Spool::erase(std::size_t const sector) {
+  ESP_LOGD(TAG, "erase sector %zu", sector);
+#ifdef USE_ESP_IDF
+  auto const error{esp_partition_erase_range(this->partition_, sector * SECTOR, SECTOR)};
+  if (ESP_OK != error) {
+    ESP_LOGW(TAG, "erase sector %zu error: %s", sector, esp_err_to_name(error));
+    return false;
+  }
+  return true;
+#else
+  std::array<std::uint8_t, SECTOR> erased;
+  erased.fill(ERASED);
+  return this->write(sector * SECTOR, erased.data(), erased.size());
+#endif
+}
+
+bool Spool::open(Replay const &replay) {
+#ifdef USE_ESP_IDF
+  this->partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, this->label_.c_str());
+  if (!this->partition_) {
+    ESP_LOGE(TAG, "partition %s not found", this->label_.c_str());
+    return false;
+  }
+  this->size_ = this->partition_->size;
+#else
+  this->file_ = std::fopen(this->label_.c_str(), "r+b");
+  auto const created{!this->file_};
+  if (created) {
+    this->file_ = std::fopen(this->label_.c_str(), "w+b");
+    if (!this->file_) {
+      ESP_LOGE(TAG, "file %s could not be created", this->label_.c_str());
+      return false;
+    }
+  }
+  this->size_ = FILE_SIZE;
+  if (created) {
+    for (std::size_t sector{0}; sector < this->size_ / SECTOR; ++sector) {
+      if (!this->erase(sector)) {
+        return false;
+      }
+    }
+  }
+#endif
+  auto const sectors{this->size_ / SECTOR};
+  if (sectors < 2) {
+    ESP_LOGE(TAG, "%s must be at least 2 sectors", this->label_.c_str());
+    return false;
+  }
+  this->pending_.assign(sectors, 0);
+
+  // scan each sector for its records, up to the first that is not whole.
+  // the next record will be written after the newest.
+  std::vector<std::pair<std::uint32_t, Record>> pending;
+  std::optional<std::uint32_t> newest;
+  for (std::size_t sector{0}; sector < sectors; ++sector) {
+    std::size_t offset{0};
+    while (offset + sizeof(Header) <= SECTOR) {
+      Header header;
+      if (!this->read(sector * SECTOR + offset, &header, sizeof header)) {
+        offset = SECTOR;
+        break;
+      }
+      if (MAGIC != header.magic) {
+        // the end, if erased. otherwise, a torn write that we must not write over.
+        auto const *const begin{reinterpret_cast<std::uint8_t const *>(&header)};
+        if (!std::all_of(begin, begin + sizeof header, [](std::uint8_t const byte) { return ERASED == byte; })) {
+          offset = SECTOR;
+        }
+        break;
+      }
+      auto const size{aligned(sizeof header + payload_size(header))};
+      if (SECTOR < offset + size) {
+        offset = SECTOR;
+        break;
+      }
+      std::string payload(payload_size(header), '\0');
+      if (!this->read(sector * SECTOR + offset + sizeof header, payload.data(), payload.size()) ||
+          header.crc != crc32(header, payload)) {
+        offset = SECTOR;
+        break;
+      }
+      if (ACKED != header.state) {
+        pending.emplace_back(header.sequence, sector * SECTOR + offset);
+        ++this->pending_[sector];
+      }
+      if (!newest || static_cast<std::int32_t>(header.sequence - *newest) > 0) {
+        newest = header.sequence;
+        this->sector_ = sector;
+      }
+      offset += size;
+    }
+    if (newest && this->sector_ == sector) {
+      this->offset_ = offset;
+    } else if (!newest && 0 == sector) {
+      this->offset_ = offset;
+    }
+  }
+  this->sequence_ = newest ? *newest + 1 : 0;
+  ESP_LOGI(TAG, "%s: %zu pending records, next at %zu", this->label_.c_str(), pending.size(),
+           this->sector_ * SECTOR + this->offset_);
+
+  // replay pending records, oldest first
+  std::ranges::sort(pending, {}, [this](auto const &found) { return found.first - this->sequence_; });
+  for (auto const &[sequence, record] : pending) {
+    Header header;
+    std::string payload;
+    if (this->read(record, &header, sizeof header)) {
+      payload.resize(payload_size(header));
+      if (this->read(record + sizeof header, payload.data(), payload.size())) {
+        std::string_view const view{payload};
+        replay(record, view.substr(0, header.subject_size), view.substr(header.subject_size, header.body_size),
+               view.substr(std::size_t{header.subject_size} + header.body_size));
+      }
+    }
+  }
+  return true;
+}
+
+bool Spool::fits(std::string_view const subject, std::string_view const body, std::string_view const to) {
+  constexpr std::size_t limit{UINT16_MAX};
+  return subject.size() <= limit && body.size() <= limit && to.size() <= limit &&
+         aligned(sizeof(Header) + subject.size() + body.size() + to.size()) <= SECTOR;
+}
+
+std::optional<Spool::Record> Spool::append(std::string_view const subject, std::string_view const body,
+                                           std::string_view const to) {
+  if (this->pending_.empty()) {
+    return {};  // not open
+  }
+  auto const size{aligned(sizeof(Header) + subject.size() + body.size() + to.size())};
+  if (!fits(subject, body, to)) {
+    ESP_LOGW(TAG, "%zu byte message too large to spool", size);
+    return {};
+  }
+
+  // move on to the next sector, if need be, and if all of its records have been acknowledged
+  if (SECTOR < this->offset_ + size) {
+    auto const sector{(this->sector_ + 1) % this->pending_.size()};
+    if (this->pending_[sector]) {
+      ESP_LOGW(TAG, "spool full");
+      return {};
+    }
+    if (!this->erase(sector)) {
+      return {};
+    }
+    this->sector_ = sector;
+    this->offset_ = 0;
+  }
+
+  Header header{
+      .crc = 0,
+      .sequence = this->sequence_,
+      .subject_size = static_cast<std::uint16_t>(subject.size()),
+      .body_size = static_cast<std::uint16_t>(body.size()),
+      .to_size = static_cast<std::uint16_t>(to.size()),
+      .magic = MAGIC,
+      .state = PENDING,
+  };
+  auto crc{crc32(header, subject)};
+  crc = crc32(crc, body.data(), body.size());
+  header.crc = crc32(crc, to.data(), to.size());
+
+  // write the header first so that a torn write is found by its crc
+  Record const record{static_cast<Record>(this->sector_ * SECTOR + this->offset_)};
+  auto offset{std::size_t{record}};
+  if (!this->write(offset, &header, sizeof header)) {
+    this->offset_ = SECTOR;  // do not write over what we may have
+    return {};
+  }
+  offset += sizeof header;
+  for (auto const part : {subject, body, to}) {
+    if (!part.empty() && !this->write(offset, part.data(), part.size())) {
+      this->offset_ = SECTOR;
+      return {};
+    }
+    offset += part.size();
+  }
+  this->offset_ += size;
+  ++this->sequence_;
+  ++this->pending_[this->sector_];
+  ESP_LOGV(TAG, "append %" PRIu32 " at %" PRIu32, header.sequence, record);
+  return record;
+}
+
+void Spool::ack(Record const record) {
+  if (this->pending_.empty()) {
+    return;  // not open
+  }
+  ESP_LOGV(TAG, "ack %" PRIu32, record);
+  static constexpr std::uint8_t state{ACKED};
+  this->write(record + offsetof(Header, state), &state, sizeof state);
+  auto &pending{this->pending_[record / SECTOR]};
+  if (pending) {
+    --pending;
+  }
+}
+
+}  // namespace smtp_
+}  // namespace esphome
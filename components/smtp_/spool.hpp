@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_ESP_IDF
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#include "esp_partition.h"
+#pragma GCC diagnostic pop
+#endif
+
+namespace esphome {
+namespace smtp_ {
+
+// Spool messages, so that they survive a reboot, in an append-only log of records
+// in a flash partition (or a plain file of that name, elsewhere).
+// The partition is used as a ring of erase sectors.
+// A record is written once and acknowledged in place by clearing its state bits,
+// which NOR flash allows without an erase.
+// A sector is erased only when the log wraps around to it and all its records have been acknowledged.
+class Spool {
+ public:
+  using Record = std::uint32_t;  // offset of a record in the partition
+  using Replay = std::function<void(Record, std::string_view subject, std::string_view body, std::string_view to)>;
+
+  explicit Spool(std::string label);
+  ~Spool();
+  Spool(Spool const &) = delete;
+  Spool &operator=(Spool const &) = delete;
+
+  // open the partition and present each unacknowledged record, oldest first, to replay
+  bool open(Replay const &replay);
+
+  // whether a record of these fits in an erase sector, as it must to be appended
+  static bool fits(std::string_view subject, std::string_view body, std::string_view to);
+
+  // append a record and return it, or nothing if it could not be
+  std::optional<Record> append(std::string_view subject, std::string_view body, std::string_view to);
+
+  // acknowledge a record so that its sector may be reused
+  void ack(Record record);
+
+  std::string const &get_label() const { return this->label_; }
+  std::size_t get_size() const { return this->size_; }
+
+ private:
+  bool read(std::size_t offset, void *data, std::size_t size);
+  bool write(std::size_t offset, void const *data, std::size_t size);
+  bool erase(std::size_t sector);
+
+  std::string const label_;
+#ifdef USE_ESP_IDF
+  esp_partition_t const *partition_;
+#else
+  std::FILE *file_;
+#endif
+  std::size_t size_;
+
+  std::vector<std::uint16_t> pending_;  // unacknowledged records in each sector
+  std::size_t sector_;                  // where the next record will be written
+  std::size_t offset_;                  // in sector_ where the next record will be written
+  std::uint32_t sequence_;              // of the next record
+};
+
+}  // namespace smtp_
+}  // namespace esphome
@@ -0,0 +1,71 @@
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wpedantic"
+#pragma GCC diagnostic error "-Wconversion"
+#pragma GCC diagnostic error "-Wsign-conversion"
+#pragma GCC diagnostic error "-Wold-style-cast"
+#pragma GCC diagnostic error "-Wshadow"
+#pragma GCC diagnostic error "-Wnull-dereference"
+#pragma GCC diagnostic error "-Wformat=2"
+#pragma GCC diagnostic error "-Wsuggest-override"
+#pragma GCC diagnostic error "-Wzero-as-null-pointer-constant"
+
+#include "worker.hpp"
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace smtp_ {
+
+namespace {
+
+constexpr auto TAG{"smtp_.worker"};
+
+}  // namespace
+
+bool Worker::start(char const *const name, UBaseType_t const priority, std::uint32_t const stack,
+                   std::size_t const depth) {
+  this->queue_ = xQueueCreate(static_cast<UBaseType_t>(depth), sizeof(Job *));
+  if (!this->queue_) {
+    ESP_LOGE(TAG, "%s queue create failed", name);
+    return false;
+  }
+  // the task needs only the queue, which it may first take after we are gone (as at exit, on the host)
+  if (pdPASS != xTaskCreate(&Worker::task, name, stack, this->queue_, priority, &this->task_)) {
+    ESP_LOGE(TAG, "%s task create failed", name);
+    vQueueDelete(this->queue_);
+    this->queue_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool Worker::submit(std::unique_ptr<Job> &job) {
+  if (!this->queue_) {
+    ESP_LOGW(TAG, "not started");
+    return false;
+  }
+  // the queue holds the pointer. the task takes ownership of it from there.
+  auto *const pointer{job.get()};
+  if (pdTRUE != xQueueSend(this->queue_, &pointer, 0)) {
+    ESP_LOGW(TAG, "queue full");
+    return false;
+  }
+  job.release();
+  return true;
+}
+
+void Worker::task(void *const parameter) {
+  auto const queue{static_cast<QueueHandle_t>(parameter)};
+  while (true) {
+    Job *pointer;
+    if (pdTRUE == xQueueReceive(queue, &pointer, portMAX_DELAY)) {
+      std::unique_ptr<Job> const job{pointer};
+      job->run();
+    }
+  }
+}
+
+}  // namespace smtp_
+}  // namespace esphome
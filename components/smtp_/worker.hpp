@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#pragma GCC diagnostic pop
+
+namespace esphome {
+namespace smtp_ {
+
+// A long-lived task that runs blocking jobs (like a TLS handshake), one at a time,
+// from a bounded queue, so that they need not block the main loop or a new thread each.
+class Worker {
+ public:
+  class Job {
+   public:
+    virtual ~Job() = default;
+    virtual void run() = 0;
+  };
+
+  explicit Worker() = default;
+  Worker(Worker const &) = delete;
+  Worker &operator=(Worker const &) = delete;
+
+  // create the task and its queue of depth jobs
+  bool start(char const *name, UBaseType_t priority, std::uint32_t stack, std::size_t depth);
+
+  // queue job to be run and take it, unless the queue is full (or the task not started): then it is left with us
+  bool submit(std::unique_ptr<Job> &job);
+
+ private:
+  static void task(void *queue);
+
+  QueueHandle_t queue_{nullptr};
+  TaskHandle_t task_{nullptr};
+};
+
+}  // namespace smtp_
+}  // namespace esphome
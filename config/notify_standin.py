@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""Stand-in receivers for the syslog, webhook and mqtt transports of smtp_ relays.
+
+Like smtp_standin.py, for SMTP, these accept any message and throw it away,
+but can be told to be slow or to fail, at random.
+A syslog receiver takes RFC 5424 messages in UDP datagrams (and never replies),
+a webhook receiver takes HTTP/1.1 POST requests of JSON objects
+and an MQTT "broker" takes MQTT 3.1.1 CONNECT and PUBLISH (QoS 1) packets but forwards nothing.
+Periodically, each reports what it has accepted: messages per second and, but for syslog,
+percentiles of latency (from the connection, or the last message on it, to each message it accepts).
+
+Point an smtp_ relay of each transport at the host that runs this, for example
+
+    relays:
+      - server: 192.168.1.2
+        port: 8080
+        transport: webhook
+        path: /smtp_
+
+and compare how soon messages are delivered by each
+from the per relay delivery latency that smtp_ logs (at DEBUG level) after each round of sessions.
+For that, shard the queue across the relays so that each takes its share.
+
+With --max-connections, a webhook or mqtt receiver that sees more connections than that in a second
+says so and, when it is interrupted, exits with status 1: an smtp_ that reconnects at once, again and again,
+to a receiver that refuses each message and closes the connection does not back off as it should.
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import sys
+import time
+
+from smtp_standin import Connections, Stats
+
+CRLF = b"\r\n"
+
+
+class Dropped(Exception):
+    pass
+
+
+class Receiver:
+    def __init__(self, name, args):
+        self.name = name
+        self.args = args
+        self.stats = Stats()
+        self.connections = Connections(args.max_connections)
+
+    def log(self, peer, text):
+        if self.args.verbose:
+            print(f"{self.name} {peer} {text}", flush=True)
+
+    async def delay(self, peer):
+        # each reply is late, and perhaps never sent at all
+        delay = self.args.latency + random.uniform(0, self.args.jitter)
+        if delay:
+            await asyncio.sleep(delay / 1000)
+        if random.random() < self.args.drop:
+            self.log(peer, "drop")
+            raise Dropped()
+
+    def fail(self):
+        # whether to fail a message, transiently or permanently, or None
+        if random.random() < self.args.transient:
+            self.stats.failed += 1
+            return "transient"
+        if random.random() < self.args.permanent:
+            self.stats.failed += 1
+            return "permanent"
+        return None
+
+    def connected(self, peer):
+        self.log(peer, "connected")
+        self.connections.count(f"{self.name}: ")
+
+    def accept(self, started, size):
+        self.stats.messages += 1
+        self.stats.bytes += size
+        if started is not None:
+            self.stats.latencies.append(time.monotonic() - started)
+
+    def report(self):
+        print(f"{self.name}:", end=" ")
+        self.stats.report()
+
+
+class Syslog(Receiver, asyncio.DatagramProtocol):
+    def __init__(self, args):
+        super().__init__("syslog", args)
+
+    def datagram_received(self, data, addr):
+        text = data.decode(errors="replace")
+        self.log(addr, text[:80])
+        if not text.startswith("<") or ">1 " not in text[:6]:
+            self.stats.failed += 1
+            return
+        self.accept(None, len(data))
+
+
+class Webhook(Receiver):
+    STATUSES = {None: "200 OK", "transient": "503 Service Unavailable", "permanent": "400 Bad Request"}
+
+    def __init__(self, args):
+        super().__init__("webhook", args)
+
+    async def serve(self, reader, writer):
+        peer = writer.get_extra_info("peername")
+        self.connected(peer)
+        started = time.monotonic()
+        try:
+            while True:
+                head = await reader.readuntil(CRLF + CRLF)
+                lines = head.decode(errors="replace").split("\r\n")
+                self.log(peer, f"< {lines[0]}")
+                fields = {}
+                for line in lines[1:]:
+                    name, _, value = line.partition(":")
+                    fields[name.strip().lower()] = value.strip()
+                content = await reader.readexactly(int(fields.get("content-length", 0)))
+                try:
+                    json.loads(content)
+                    failure = self.fail()
+                except ValueError:
+                    failure = "permanent"
+                await self.delay(peer)
+                status = self.STATUSES[failure]
+                close = random.random() < self.args.close
+                response = f"HTTP/1.1 {status}\r\nContent-Length: 0\r\n"
+                if close:
+                    response += "Connection: close\r\n"
+                writer.write(response.encode() + CRLF)
+                await writer.drain()
+                self.log(peer, f"> {status}")
+                if failure is None:
+                    self.accept(started, len(content))
+                started = time.monotonic()
+                if close:
+                    return
+        except (Dropped, ConnectionError, asyncio.IncompleteReadError, ValueError) as error:
+            self.log(peer, f"disconnected {type(error).__name__}")
+        finally:
+            writer.close()
+
+
+class Mqtt(Receiver):
+    CONNECT, CONNACK, PUBLISH, PUBACK, PINGREQ, PINGRESP, DISCONNECT = 1, 2, 3, 4, 12, 13, 14
+
+    def __init__(self, args):
+        super().__init__("mqtt", args)
+
+    @staticmethod
+    async def packet(reader):
+        first = (await reader.readexactly(1))[0]
+        length, shift = 0, 0
+        while True:
+            byte = (await reader.readexactly(1))[0]
+            length |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        return first >> 4, first & 0x0F, await reader.readexactly(length)
+
+    async def serve(self, reader, writer):
+        peer = writer.get_extra_info("peername")
+        self.connected(peer)
+        started = time.monotonic()
+        try:
+            while True:
+                kind, flags, rest = await self.packet(reader)
+                if self.CONNECT == kind:
+                    self.log(peer, "< CONNECT")
+                    await self.delay(peer)
+                    writer.write(bytes([self.CONNACK << 4, 2, 0, 0]))
+                elif self.PUBLISH == kind:
+                    topic_size = int.from_bytes(rest[:2], "big")
+                    topic = rest[2 : 2 + topic_size].decode(errors="replace")
+                    qos = flags >> 1 & 3
+                    payload = rest[2 + topic_size + (2 if qos else 0) :]
+                    self.log(peer, f"< PUBLISH {topic} {payload[:60]!r}")
+                    await self.delay(peer)
+                    # MQTT 3.1.1 cannot refuse a message: a failure is a dropped connection
+                    if self.fail():
+                        raise Dropped()
+                    if qos:
+                        writer.write(bytes([self.PUBACK << 4, 2]) + rest[2 + topic_size : 4 + topic_size])
+                    self.accept(started, len(payload))
+                    started = time.monotonic()
+                elif self.PINGREQ == kind:
+                    writer.write(bytes([self.PINGRESP << 4, 0]))
+                elif self.DISCONNECT == kind:
+                    self.log(peer, "< DISCONNECT")
+                    return
+                await writer.drain()
+        except (Dropped, ConnectionError, asyncio.IncompleteReadError) as error:
+            self.log(peer, f"disconnected {type(error).__name__}")
+        finally:
+            writer.close()
+
+
+async def main(receivers):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--syslog-port", type=int, default=5514, help="UDP, or 0 for none")
+    parser.add_argument("--webhook-port", type=int, default=8080, help="or 0 for none")
+    parser.add_argument("--mqtt-port", type=int, default=1883, help="or 0 for none")
+    parser.add_argument("--latency", type=float, default=0, help="ms before each reply")
+    parser.add_argument("--jitter", type=float, default=0, help="up to this many more ms, at random")
+    parser.add_argument("--transient", type=float, default=0, help="probability a message fails for now")
+    parser.add_argument("--permanent", type=float, default=0, help="probability a webhook message fails for good")
+    parser.add_argument("--drop", type=float, default=0, help="probability the connection drops instead of a reply")
+    parser.add_argument("--close", type=float, default=0, help="probability a webhook response closes the connection")
+    parser.add_argument("--max-connections", type=int, default=0, help="per second, beyond which to fail")
+    parser.add_argument("--report", type=float, default=10, help="seconds between reports")
+    parser.add_argument("--seed", type=int, help="of random faults, to repeat them")
+    parser.add_argument("--verbose", action="store_true", help="log each message")
+    args = parser.parse_args()
+    random.seed(args.seed)
+
+    servers = []
+    loop = asyncio.get_running_loop()
+    if args.syslog_port:
+        syslog = Syslog(args)
+        await loop.create_datagram_endpoint(lambda: syslog, local_addr=(args.host, args.syslog_port))
+        receivers.append(syslog)
+        print(f"syslog listening on {args.host}:{args.syslog_port}/udp", flush=True)
+    for port, receiver in ((args.webhook_port, Webhook(args)), (args.mqtt_port, Mqtt(args))):
+        if port:
+            servers.append(await asyncio.start_server(receiver.serve, args.host, port))
+            receivers.append(receiver)
+            print(f"{receiver.name} listening on {args.host}:{port}", flush=True)
+
+    while True:
+        await asyncio.sleep(args.report)
+        for receiver in receivers:
+            receiver.report()
+
+
+if __name__ == "__main__":
+    receivers = []
+    try:
+        asyncio.run(main(receivers))
+    except KeyboardInterrupt:
+        pass
+    sys.exit(1 if any(receiver.connections.hot for receiver in receivers) else 0)
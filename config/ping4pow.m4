@@ -137,7 +137,8 @@ define(`_repeat', `ifelse(0, `$1', `', `$2`'_repeat(decr(`$1'), `$2')')')dnl
 define(`_indent', `_repeat(`$1', `  ')')dnl
 define(`_smtp_send_', `_indent($1)- smtp_.send:
 _indent(eval(2+$1))subject: NAME $2
-')dnl
+ifelse(`$3', `', `', `_indent(eval(2+$1))priority: $3
+')')dnl
 define(`_smtp_send', `')dnl
 define(`_smtp_define', `$1`'define(`_smtp_send', defn(`_smtp_send_'))')dnl
 sinclude(SMTP)dnl
@@ -375,7 +376,7 @@ ifdef(`GPIO_RELAY', `dnl
           state: 5
       - switch.turn_off: power_
       - lambda: !lambda id(power_since_)->set_when();
-_smtp_send(3, power cycle)`'dnl
+_smtp_send(3, power cycle, urgent)`'dnl
       - wait_until:
           condition:
             switch.is_off: state_5_
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""A stand-in service to exercise the TCP and UDP probes of ping_ targets against, instead of a real one.
+
+On the same port, it accepts (and closes) each TCP connection and echoes each UDP request,
+but can be told to be slow to echo, or to not echo at all, at random.
+Periodically, it reports what it has seen: connections and requests per second.
+
+Point a ping_ target at the host that runs this, for example
+
+    address: 192.168.1.2
+    probe: udp
+    port: 7007
+    payload: ping
+"""
+
+import argparse
+import asyncio
+import random
+import socket
+import time
+
+
+class Stats:
+    def __init__(self):
+        self.connections = 0
+        self.requests = 0
+        self.echoes = 0
+        self.since = time.monotonic()
+
+    def report(self):
+        elapsed = time.monotonic() - self.since
+        print(
+            f"{time.strftime('%X')} {self.connections} connections ({self.connections / elapsed:.1f}/s),"
+            f" {self.requests} requests ({self.requests / elapsed:.1f}/s), {self.echoes} echoed",
+            flush=True,
+        )
+        self.__init__()
+
+
+class Echo(asyncio.DatagramProtocol):
+    def __init__(self, args, stats):
+        self.args = args
+        self.stats = stats
+        self.transport = None
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, address):
+        self.stats.requests += 1
+        if random.random() < self.args.silent:
+            return
+        delay = (self.args.latency + random.uniform(0, self.args.jitter)) / 1000
+        asyncio.get_running_loop().call_later(delay, self.echo, data, address)
+
+    def echo(self, data, address):
+        self.stats.echoes += 1
+        self.transport.sendto(data, address)
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=7007, help="or 0 for any that is free")
+    parser.add_argument("--latency", type=float, default=0, help="ms before each echo")
+    parser.add_argument("--jitter", type=float, default=0, help="up to this many more ms, at random")
+    parser.add_argument("--silent", type=float, default=0, help="probability a request is not echoed")
+    parser.add_argument("--report", type=float, default=10, help="seconds between reports")
+    parser.add_argument("--seed", type=int, help="of random faults, to repeat them")
+    args = parser.parse_args()
+    random.seed(args.seed)
+
+    stats = Stats()
+
+    def serve(reader, writer):
+        stats.connections += 1
+        writer.close()
+
+    # TCP on a free port (if asked for one), then UDP on the same
+    server = await asyncio.start_server(serve, args.host, args.port, backlog=1024)
+    port = server.sockets[0].getsockname()[1]
+    await asyncio.get_running_loop().create_datagram_endpoint(
+        lambda: Echo(args, stats), local_addr=(args.host, port), family=socket.AF_INET
+    )
+    print(f"listening on {args.host}:{port}", flush=True)
+    async with server:
+        while True:
+            await asyncio.sleep(args.report)
+            stats.report()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
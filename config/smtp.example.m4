@@ -5,4 +5,5 @@ _smtp_define(smtp_:
   from: <sender>@gmail.com
   to: <recipient>@gmail.com
   cas: smtp.gmail.com-cas.pem
+  spool: spool
 )
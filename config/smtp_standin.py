@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+"""A stand-in SMTP server to exercise the smtp_ component against, instead of a real relay.
+
+It accepts any credentials and any message, and throws the messages away,
+but can be told to be slow, to fail, to stall or to drop the connection, at random.
+It offers PIPELINING, CHUNKING (BDAT), AUTH PLAIN and LOGIN and, given a certificate, STARTTLS,
+any of which can be withheld.
+Periodically, it reports what it has accepted: messages per second and
+percentiles of transaction latency (from MAIL FROM to the reply that accepts the message).
+
+Point an smtp_ relay at the host that runs this, for example
+
+    server: 192.168.1.2
+    port: 2525
+    starttls: false
+
+For STARTTLS, make a certificate for it and configure its CA in cas
+
+    openssl req -x509 -newkey rsa:2048 -nodes -days 365 -subj /CN=192.168.1.2 \\
+        -addext subjectAltName=IP:192.168.1.2 -keyout standin.key -out standin.pem
+    ./smtp_standin.py --cert standin.pem --key standin.key
+
+To load it, have the device send messages faster than usual (say, from an interval automation).
+
+With --max-connections, it says so when it sees more connections than that in a second and,
+when it is interrupted, exits with status 1: an smtp_ that reconnects at once, again and again, does not back off.
+"""
+
+import argparse
+import asyncio
+import base64
+import collections
+import random
+import ssl
+import statistics
+import sys
+import time
+
+CRLF = b"\r\n"
+
+
+class Stats:
+    def __init__(self):
+        self.messages = 0
+        self.failed = 0
+        self.bytes = 0
+        self.latencies = []  # of transactions since the last report, in seconds
+        self.since = time.monotonic()
+
+    def report(self):
+        now = time.monotonic()
+        elapsed = now - self.since
+        text = f"{self.messages} messages ({self.messages / elapsed:.2f}/s, {self.bytes} bytes), {self.failed} failed"
+        if 2 <= len(self.latencies):
+            quantiles = statistics.quantiles(self.latencies, n=100, method="inclusive")
+            text += f", latency p50 {quantiles[49] * 1000:.0f} ms, p99 {quantiles[98] * 1000:.0f} ms"
+        elif self.latencies:
+            text += f", latency {self.latencies[0] * 1000:.0f} ms"
+        print(f"{time.strftime('%X')} {text}", flush=True)
+        self.__init__()
+
+
+class Connections:
+    def __init__(self, maximum):
+        self.maximum = maximum  # per second, or 0 for any
+        self.times = collections.deque()  # of those in the last second
+        self.hot = False  # whether there were ever more than maximum
+
+    def count(self, name):
+        now = time.monotonic()
+        self.times.append(now)
+        while self.times[0] < now - 1:
+            self.times.popleft()
+        if self.maximum and self.maximum < len(self.times) and not self.hot:
+            print(f"{name}{len(self.times)} connections in a second", flush=True)
+            self.hot = True
+
+
+class Dropped(Exception):
+    pass
+
+
+class Session:
+    def __init__(self, args, stats, tls, reader, writer):
+        self.args = args
+        self.stats = stats
+        self.tls = tls
+        self.reader = reader
+        self.writer = writer
+        self.secure = False
+        self.peer = writer.get_extra_info("peername")
+        self.reset()
+
+    def reset(self):
+        self.started = None  # by MAIL FROM
+        self.content = 0  # bytes of BDAT chunks
+
+    def log(self, text):
+        if self.args.verbose:
+            print(f"{self.peer} {text}", flush=True)
+
+    async def reply(self, code, *lines):
+        # each reply is late, and perhaps very late, or never sent at all
+        delay = self.args.latency + random.uniform(0, self.args.jitter)
+        if random.random() < self.args.stall:
+            self.log("stall")
+            delay += self.args.stall_time
+        if delay:
+            await asyncio.sleep(delay / 1000)
+        if random.random() < self.args.drop:
+            self.log("drop")
+            raise Dropped()
+        lines = lines or ("",)
+        for index, line in enumerate(lines):
+            separator = " " if index == len(lines) - 1 else "-"
+            self.writer.write(f"{code}{separator}{line}".encode() + CRLF)
+        await self.writer.drain()
+        self.log(f"> {code} {lines[-1]}")
+
+    async def readline(self):
+        try:
+            line = await asyncio.wait_for(self.reader.readline(), self.args.timeout / 1000 or None)
+        except asyncio.TimeoutError:
+            # as a real server does with a client that says nothing for too long
+            self.log("timeout")
+            self.writer.write(b"421 timeout" + CRLF)
+            raise Dropped()
+        if not line:
+            raise Dropped()
+        return line.rstrip(CRLF).decode(errors="replace")
+
+    async def complete(self, size):
+        # reply to the end of a message, failing it perhaps
+        latency = time.monotonic() - self.started
+        self.reset()
+        if random.random() < self.args.transient:
+            self.stats.failed += 1
+            return await self.reply(451, "transient failure injected")
+        if random.random() < self.args.permanent:
+            self.stats.failed += 1
+            return await self.reply(550, "permanent failure injected")
+        self.stats.messages += 1
+        self.stats.bytes += size
+        self.stats.latencies.append(latency)
+        await self.reply(250, "accepted")
+
+    def capabilities(self):
+        capabilities = ["standin"]
+        if not self.args.no_pipelining:
+            capabilities.append("PIPELINING")
+        if not self.args.no_chunking:
+            capabilities.append("CHUNKING")
+        if self.tls and not self.secure:
+            capabilities.append("STARTTLS")
+        if self.args.auth:
+            capabilities.append("AUTH " + " ".join(self.args.auth))
+        return capabilities
+
+    async def auth(self, words):
+        mechanism = words[1].upper() if 1 < len(words) else ""
+        if mechanism not in self.args.auth:
+            return await self.reply(504, "mechanism not supported")
+        if "PLAIN" == mechanism:
+            if len(words) < 3:
+                await self.reply(334)
+                await self.readline()
+        else:
+            await self.reply(334, base64.b64encode(b"Username:").decode())
+            await self.readline()
+            await self.reply(334, base64.b64encode(b"Password:").decode())
+            await self.readline()
+        await self.reply(235, "authenticated")
+
+    async def data(self):
+        await self.reply(354, "end with .")
+        size = 0
+        while True:
+            line = await self.reader.readline()
+            if not line:
+                raise Dropped()
+            if b"." == line.rstrip(CRLF):
+                break
+            size += len(line) - line.startswith(b".")
+        await self.complete(size)
+
+    async def bdat(self, words):
+        try:
+            size = int(words[1])
+        except (IndexError, ValueError):
+            return await self.reply(501, "BDAT size [LAST]")
+        await self.reader.readexactly(size)
+        self.content += size
+        if self.started is None:
+            return await self.reply(503, "no MAIL FROM")
+        if 2 < len(words) and "LAST" == words[2].upper():
+            return await self.complete(self.content)
+        await self.reply(250, f"{size} bytes")
+
+    async def run(self):
+        await self.reply(220, "standin ESMTP")
+        while True:
+            line = await self.readline()
+            self.log(f"< {line[:80]}")
+            words = line.split()
+            verb = words[0].upper() if words else ""
+            if verb in ("EHLO", "HELO"):
+                self.reset()
+                await self.reply(250, *self.capabilities())
+            elif "STARTTLS" == verb and self.tls and not self.secure:
+                await self.reply(220, "ready to start TLS")
+                await self.writer.start_tls(self.tls)
+                self.secure = True
+            elif "AUTH" == verb:
+                await self.auth(words)
+            elif "MAIL" == verb:
+                self.reset()
+                self.started = time.monotonic()
+                await self.reply(250, "sender ok")
+            elif "RCPT" == verb:
+                await self.reply(250 if self.started else 503, "recipient ok" if self.started else "no MAIL FROM")
+            elif "DATA" == verb:
+                if self.started is None:
+                    await self.reply(503, "no MAIL FROM")
+                else:
+                    await self.data()
+            elif "BDAT" == verb and not self.args.no_chunking:
+                await self.bdat(words)
+            elif "RSET" == verb:
+                self.reset()
+                await self.reply(250, "reset")
+            elif "NOOP" == verb:
+                await self.reply(250, "ok")
+            elif "QUIT" == verb:
+                await self.reply(221, "bye")
+                return
+            else:
+                await self.reply(502, "not implemented")
+
+
+async def main(connections):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=2525, help="or 0 for any that is free")
+    parser.add_argument("--cert", help="certificate chain (PEM) to offer STARTTLS with")
+    parser.add_argument("--key", help="private key (PEM) of cert")
+    parser.add_argument("--no-resumption", action="store_true", help="of TLS sessions (by id or ticket)")
+    parser.add_argument("--no-pipelining", action="store_true")
+    parser.add_argument("--no-chunking", action="store_true")
+    parser.add_argument("--auth", nargs="*", default=["PLAIN", "LOGIN"], type=str.upper, help="mechanisms offered")
+    parser.add_argument("--latency", type=float, default=0, help="ms before each reply")
+    parser.add_argument("--jitter", type=float, default=0, help="up to this many more ms, at random")
+    parser.add_argument("--transient", type=float, default=0, help="probability a message fails 451")
+    parser.add_argument("--permanent", type=float, default=0, help="probability a message fails 550")
+    parser.add_argument("--stall", type=float, default=0, help="probability a reply stalls")
+    parser.add_argument("--stall-time", type=float, default=60000, help="ms a stalled reply is late")
+    parser.add_argument("--drop", type=float, default=0, help="probability the connection drops instead of a reply")
+    parser.add_argument("--timeout", type=float, default=0, help="ms a session may be idle before it is closed")
+    parser.add_argument("--max-connections", type=int, default=0, help="per second, beyond which to fail")
+    parser.add_argument("--report", type=float, default=10, help="seconds between reports")
+    parser.add_argument("--seed", type=int, help="of random faults, to repeat them")
+    parser.add_argument("--verbose", action="store_true", help="log each command and reply")
+    args = parser.parse_args()
+    random.seed(args.seed)
+
+    def context():
+        tls = ssl.create_default_context(ssl.Purpose.CLIENT_AUTH)
+        tls.load_cert_chain(args.cert, args.key)
+        return tls
+
+    tls = context() if args.cert else None
+
+    stats = Stats()
+    connections.maximum = args.max_connections
+
+    async def serve(reader, writer):
+        # a context of its own, whose session cache and ticket key no other session knows, resumes none
+        session = Session(args, stats, context() if tls and args.no_resumption else tls, reader, writer)
+        session.log("connected")
+        connections.count("")
+        try:
+            await session.run()
+        except (Dropped, ConnectionError, asyncio.IncompleteReadError, ssl.SSLError) as error:
+            session.log(f"disconnected {type(error).__name__}")
+        finally:
+            writer.close()
+
+    server = await asyncio.start_server(serve, args.host, args.port)
+    port = server.sockets[0].getsockname()[1]
+    print(f"listening on {args.host}:{port}", flush=True)
+    async with server:
+        while True:
+            await asyncio.sleep(args.report)
+            stats.report()
+
+
+if __name__ == "__main__":
+    connections = Connections(0)
+    try:
+        asyncio.run(main(connections))
+    except KeyboardInterrupt:
+        pass
+    sys.exit(1 if connections.hot else 0)
@@ -0,0 +1,4 @@
+#pragma once
+
+#include "asio/ssl/context.hpp"
+#include "asio/ssl/stream.hpp"
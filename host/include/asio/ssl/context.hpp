@@ -0,0 +1,36 @@
+#pragma once
+
+// asio::ssl on the host: a context of OpenSSL, for the TLS of host::tls (see asio/ssl/stream.hpp)
+
+#include <system_error>
+
+#include <asio/buffer.hpp>
+
+struct ssl_ctx_st;
+
+namespace asio {
+namespace ssl {
+
+using verify_mode = int;
+inline constexpr verify_mode verify_none{0};
+inline constexpr verify_mode verify_peer{1};
+
+class context {
+ public:
+  enum method { tls_client, tlsv12_client, tlsv13_client };
+
+  explicit context(method);
+  ~context();
+  context(context const &) = delete;
+  context &operator=(context const &) = delete;
+
+  void add_certificate_authority(const_buffer const &certificate, std::error_code &ec);
+
+  ssl_ctx_st *native_handle() { return this->context_; }
+
+ private:
+  ssl_ctx_st *context_;
+};
+
+}  // namespace ssl
+}  // namespace asio
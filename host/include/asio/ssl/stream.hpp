@@ -0,0 +1,172 @@
+#pragma once
+
+// asio::ssl::stream on the host: plain text through to the next layer, with no handshake, unless host::tls is set.
+// so a relay of implicit TLS (no STARTTLS) may be a plain SMTP server, like config/smtp_standin.py.
+// with host::tls, it is TLS 1.2 (as mbedTLS is on the device) through OpenSSL, whose BIO reads and writes
+// through the next layer, so that a relay of STARTTLS may be config/smtp_standin.py with a certificate.
+
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <asio/async_result.hpp>
+#include <asio/compose.hpp>
+#include <asio/post.hpp>
+#include <asio/socket_base.hpp>
+#include <asio/write.hpp>  // as the asio::ssl::stream of the device includes it
+
+#include "asio/ssl/context.hpp"
+#include "mbedtls/ssl.h"
+
+namespace host {
+
+// how long a handshake blocks its thread, to stand for the mbedTLS handshake of the device (not at all, unless set)
+extern std::chrono::milliseconds handshake;
+// whether a handshake is one of TLS (or none at all)
+extern bool tls;
+
+// the next layer of a stream, for the BIO of its TLS
+struct Layer {
+  void *stream;
+  std::size_t (*read_some)(void *stream, asio::mutable_buffer buffer, std::error_code &ec);
+  std::size_t (*write_some)(void *stream, asio::const_buffer buffer, std::error_code &ec);
+  std::error_code error;  // of the last read_some or write_some
+};
+
+// what TLS waits for of the next layer (which does not block) before it can go on
+enum class Want : std::uint8_t { NOTHING, READ, WRITE };
+
+std::error_code tls_handshake(mbedtls_ssl_context &context, Layer &layer);
+std::size_t tls_read(mbedtls_ssl_context &context, asio::mutable_buffer buffer, std::error_code &ec, Want &want);
+std::size_t tls_write(mbedtls_ssl_context &context, asio::const_buffer buffer, std::error_code &ec, Want &want);
+void tls_shutdown(mbedtls_ssl_context &context);
+void tls_free(mbedtls_ssl_context &context);
+
+// the first buffer of a sequence that is not empty (or an empty one)
+template<typename Buffer, typename Buffers> Buffer first(Buffers const &buffers) {
+  for (auto i{asio::buffer_sequence_begin(buffers)}; i != asio::buffer_sequence_end(buffers); ++i) {
+    Buffer const buffer(*i);
+    if (buffer.size()) {
+      return buffer;
+    }
+  }
+  return Buffer{};
+}
+
+}  // namespace host
+
+namespace asio {
+namespace ssl {
+
+class stream_base {
+ public:
+  enum handshake_type { client, server };
+
+ protected:
+  ~stream_base() = default;
+};
+
+template<typename Stream> class stream : public stream_base {
+ public:
+  using next_layer_type = std::remove_reference_t<Stream>;
+  using lowest_layer_type = typename next_layer_type::lowest_layer_type;
+  using executor_type = typename next_layer_type::executor_type;
+  using native_handle_type = mbedtls_ssl_context *;
+
+  template<typename Arg>
+  stream(Arg &&arg, context &context)
+      : next_layer_{std::forward<Arg>(arg)}, layer_{this, &stream::read_some_, &stream::write_some_, {}} {
+    this->context_.configuration = context.native_handle();
+  }
+  stream(stream const &) = delete;
+  stream &operator=(stream const &) = delete;
+  ~stream() { host::tls_free(this->context_); }
+
+  executor_type get_executor() noexcept { return this->next_layer_.get_executor(); }
+  next_layer_type &next_layer() { return this->next_layer_; }
+  lowest_layer_type &lowest_layer() { return this->next_layer_.lowest_layer(); }
+  native_handle_type native_handle() { return &this->context_; }
+
+  void set_verify_mode(verify_mode const mode, std::error_code &ec) {
+    this->context_.verify = verify_peer == mode;
+    ec = {};
+  }
+  void handshake(handshake_type, std::error_code &ec) {
+    std::this_thread::sleep_for(host::handshake);
+    ec = host::tls ? host::tls_handshake(this->context_, this->layer_) : std::error_code{};
+  }
+
+  template<typename Token> auto async_shutdown(Token &&token) {
+    return asio::async_initiate<Token, void(std::error_code)>(
+        [this](auto handler) {
+          host::tls_shutdown(this->context_);  // as much of it as the next layer takes at once
+          asio::post(this->get_executor(), [handler = std::move(handler)]() mutable { handler(std::error_code{}); });
+        },
+        token);
+  }
+
+  template<typename Buffers, typename Token> auto async_read_some(Buffers const &buffers, Token &&token) {
+    return this->async_some_<asio::mutable_buffer>(buffers, std::forward<Token>(token), [this](auto &&...args) {
+      return host::tls_read(this->context_, std::forward<decltype(args)>(args)...);
+    });
+  }
+  template<typename Buffers, typename Token> auto async_write_some(Buffers const &buffers, Token &&token) {
+    return this->async_some_<asio::const_buffer>(buffers, std::forward<Token>(token), [this](auto &&...args) {
+      return host::tls_write(this->context_, std::forward<decltype(args)>(args)...);
+    });
+  }
+
+ private:
+  Stream next_layer_;
+  mbedtls_ssl_context context_{};
+  host::Layer layer_;
+
+  static std::size_t read_some_(void *const self, asio::mutable_buffer const buffer, std::error_code &ec) {
+    return static_cast<stream *>(self)->next_layer_.read_some(buffer, ec);
+  }
+  static std::size_t write_some_(void *const self, asio::const_buffer const buffer, std::error_code &ec) {
+    return static_cast<stream *>(self)->next_layer_.write_some(buffer, ec);
+  }
+
+  // read or write some: in plain text, through to the next layer, or through TLS, waiting on the next layer
+  // for as long as it wants
+  template<typename Buffer, typename Buffers, typename Token, typename Tls>
+  auto async_some_(Buffers const &buffers, Token &&token, Tls tls) {
+    return asio::async_compose<Token, void(std::error_code, std::size_t)>(
+        [this, buffers, tls, started{false}](auto &self, std::error_code ec = {}, std::size_t size = 0) mutable {
+          if (!this->context_.ssl) {
+            if (std::exchange(started, true)) {
+              self.complete(ec, size);
+            } else if constexpr (std::is_same_v<Buffer, asio::mutable_buffer>) {
+              this->next_layer_.async_read_some(buffers, std::move(self));
+            } else {
+              this->next_layer_.async_write_some(buffers, std::move(self));
+            }
+            return;
+          }
+          if (!std::exchange(started, true)) {
+            asio::post(this->get_executor(), std::move(self));  // rather than complete within the initiation
+            return;
+          }
+          auto const buffer{host::first<Buffer>(buffers)};
+          auto want{host::Want::NOTHING};
+          if (!ec && buffer.size()) {
+            size = tls(buffer, ec, want);
+          }
+          if (host::Want::NOTHING != want) {
+            this->next_layer_.async_wait(
+                host::Want::READ == want ? asio::socket_base::wait_read : asio::socket_base::wait_write,
+                std::move(self));
+            return;
+          }
+          self.complete(ec, size);
+        },
+        token, this->next_layer_);
+  }
+};
+
+}  // namespace ssl
+}  // namespace asio
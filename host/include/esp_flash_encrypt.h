@@ -0,0 +1,3 @@
+#pragma once
+
+inline bool esp_flash_encryption_enabled() { return false; }
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+[[noreturn]] inline void esp_system_abort(char const *details) {
+  std::fprintf(stderr, "abort: %s\n", details);
+  std::abort();
+}
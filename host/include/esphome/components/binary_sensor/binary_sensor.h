@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  explicit BinarySensor(std::string const &name = "") : name_{name} {}
+  virtual ~BinarySensor() = default;
+
+  void publish_state(bool value) {
+    this->state = value;
+    this->has_state_ = true;
+  }
+  bool has_state() const { return this->has_state_; }
+
+  void set_name(std::string const &value) { this->name_ = value; }
+  char const *get_name() const { return this->name_.c_str(); }
+
+  bool state{false};
+
+ private:
+  std::string name_;
+  bool has_state_{false};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
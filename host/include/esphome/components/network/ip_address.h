@@ -0,0 +1,40 @@
+#pragma once
+
+// an IPv4 address, as ESPHome's converts to that of lwIP (ip_addr_t, in network byte order).
+// lwIP's byte order functions come with it, as they do on the device.
+
+#include <arpa/inet.h>
+
+#include <cstdint>
+#include <string>
+
+struct ip_addr_t {
+  struct {
+    struct {
+      std::uint32_t addr;
+    } ip4;
+  } u_addr;
+};
+
+namespace esphome {
+namespace network {
+
+class IPAddress {
+ public:
+  IPAddress() = default;
+  explicit IPAddress(std::string const &text) { this->ok_ = 1 == inet_pton(AF_INET, text.c_str(), &this->address_); }
+
+  explicit operator ip_addr_t() const { return {{{this->address_.s_addr}}}; }
+  bool is_set() const { return this->ok_; }
+  std::string str() const {
+    char text[INET_ADDRSTRLEN];
+    return inet_ntop(AF_INET, &this->address_, text, sizeof text) ? text : "";
+  }
+
+ private:
+  in_addr address_{};
+  bool ok_{false};
+};
+
+}  // namespace network
+}  // namespace esphome
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  explicit Sensor(std::string const &name = "") : name_{name} {}
+  virtual ~Sensor() = default;
+
+  void publish_state(float value) {
+    this->state = value;
+    this->has_state_ = true;
+    for (auto const &callback : this->callbacks_) {
+      callback(value);
+    }
+  }
+  void add_on_state_callback(std::function<void(float)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+  bool has_state() const { return this->has_state_; }
+
+  void set_name(std::string const &value) { this->name_ = value; }
+  char const *get_name() const { return this->name_.c_str(); }
+
+  float state{NAN};
+
+ private:
+  std::string name_;
+  bool has_state_{false};
+  std::vector<std::function<void(float)>> callbacks_;
+};
+
+}  // namespace sensor
+}  // namespace esphome
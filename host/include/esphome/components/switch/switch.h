@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+namespace switch_ {
+
+class Switch {
+ public:
+  explicit Switch(std::string const &name = "") : name_{name} {}
+  virtual ~Switch() = default;
+
+  // as from the frontend: the switch is asked to change, and publishes the state it changed to
+  void turn_on() { this->write_state(true); }
+  void turn_off() { this->write_state(false); }
+  void publish_state(bool value) { this->state = value; }
+
+  void set_name(std::string const &value) { this->name_ = value; }
+  char const *get_name() const { return this->name_.c_str(); }
+
+  bool state{false};
+
+ protected:
+  virtual void write_state(bool state) = 0;
+
+ private:
+  std::string name_;
+};
+
+}  // namespace switch_
+}  // namespace esphome
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  explicit TextSensor(std::string const &name = "") : name_{name} {}
+  virtual ~TextSensor() = default;
+
+  void publish_state(std::string const &value) {
+    this->state = value;
+    this->has_state_ = true;
+  }
+  bool has_state() const { return this->has_state_; }
+
+  void set_name(std::string const &value) { this->name_ = value; }
+  char const *get_name() const { return this->name_.c_str(); }
+
+  std::string state{};
+
+ private:
+  std::string name_;
+  bool has_state_{false};
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
@@ -0,0 +1,57 @@
+#pragma once
+
+// the ESPHome application: its components and their scheduler, driven by a host program's own loop
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+
+class Application {
+ public:
+  void set_name(std::string const &value) { this->name_ = value; }
+  std::string const &get_name() const { return this->name_; }
+
+  void register_component(Component *component) { this->components_.push_back(component); }
+
+  // set up each component, in order of setup priority, then dump their configuration
+  void setup();
+  // loop each component, then call what is deferred or due
+  void loop();
+  // call each component's teardown until all are done, or timeout passes. return whether all are.
+  bool teardown(std::chrono::milliseconds timeout);
+
+  // scheduler, for Component
+  void defer(std::function<void()> &&function);
+  void set_interval(Component *component, std::string const &name, std::uint32_t interval,
+                    std::function<void()> &&function);
+  void set_timeout(Component *component, std::string const &name, std::uint32_t timeout,
+                   std::function<void()> &&function);
+
+ private:
+  struct Item {
+    Component *component;
+    std::string name;
+    std::chrono::steady_clock::time_point due;
+    std::chrono::milliseconds interval;  // or zero, once
+    std::function<void()> function;
+  };
+  void schedule(Item &&item);
+
+  std::string name_{"host"};
+  std::vector<Component *> components_;
+  std::mutex mutex_;  // of deferred_
+  std::vector<std::function<void()>> deferred_;
+  std::list<Item> items_;
+};
+
+extern Application App;
+
+}  // namespace esphome
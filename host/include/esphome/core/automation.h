@@ -0,0 +1,49 @@
+#pragma once
+
+// ESPHome actions, and the values of their templatable parameters
+
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace esphome {
+
+template<typename T, typename... X> class TemplatableValue {
+ public:
+  TemplatableValue() = default;
+  template<typename V> TemplatableValue(V value) {
+    if constexpr (std::is_invocable_r_v<T, V, X...>) {
+      this->function_ = std::move(value);
+    } else {
+      this->function_ = [value = T(std::move(value))](X...) { return value; };
+    }
+  }
+
+  bool has_value() const { return static_cast<bool>(this->function_); }
+  T value(X... x) const { return this->function_(x...); }
+  std::optional<T> optional_value(X... x) const {
+    if (!this->has_value()) {
+      return {};
+    }
+    return this->value(x...);
+  }
+
+ private:
+  std::function<T(X...)> function_;
+};
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play(Ts... x) = 0;
+};
+
+}  // namespace esphome
+
+#define TEMPLATABLE_VALUE(type, name) \
+ protected: \
+  TemplatableValue<type, Ts...> name##_{}; \
+\
+ public: \
+  template<typename V> void set_##name(V name) { this->name##_ = name; }
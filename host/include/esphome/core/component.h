@@ -0,0 +1,57 @@
+#pragma once
+
+// ESPHome components, as far as those here use them, scheduled by App (application.h)
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace esphome {
+
+namespace setup_priority {
+inline constexpr float HARDWARE{800.0f};
+inline constexpr float DATA{600.0f};
+inline constexpr float WIFI{250.0f};
+inline constexpr float AFTER_WIFI{200.0f};
+inline constexpr float AFTER_CONNECTION{100.0f};
+inline constexpr float LATE{-100.0f};
+}  // namespace setup_priority
+
+class Component {
+ public:
+  virtual ~Component() = default;
+
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return setup_priority::DATA; }
+  virtual bool teardown() { return true; }  // when done, or to be called again
+
+  void mark_failed() { this->failed_ = true; }
+  bool is_failed() const { return this->failed_; }
+
+ protected:
+  // from any thread, to be called from the next App.loop()
+  void defer(std::function<void()> &&function);
+  // from the main loop, every interval ms (replacing any of the same name)
+  void set_interval(std::string const &name, std::uint32_t interval, std::function<void()> &&function);
+  void set_timeout(std::string const &name, std::uint32_t timeout, std::function<void()> &&function);
+
+ private:
+  bool failed_{false};
+};
+
+class PollingComponent : public Component {
+ public:
+  PollingComponent() = default;
+  explicit PollingComponent(std::uint32_t update_interval) : update_interval_{update_interval} {}
+
+  virtual void update() = 0;  // every update_interval ms, from App.setup() on
+  void set_update_interval(std::uint32_t value) { this->update_interval_ = value; }
+  std::uint32_t get_update_interval() const { return this->update_interval_; }
+
+ protected:
+  std::uint32_t update_interval_{60000};
+};
+
+}  // namespace esphome
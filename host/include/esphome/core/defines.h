@@ -0,0 +1,3 @@
+#pragma once
+
+// not USE_ESP_IDF: a Spool is a plain file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+
+std::uint32_t random_uint32();
+
+// of this host, as ESPHome formats that of the device (lower case hex, no separators)
+std::string get_mac_address();
+
+}  // namespace esphome
@@ -0,0 +1,42 @@
+#pragma once
+
+// ESPHome logging, to stdout (or a hook) at or above a level set at run time.
+// like ESPHome, arguments are not evaluated at all below that level.
+// formats are not checked: they are written for the 32-bit device, where int64_t is long long.
+
+#include <cstdio>
+
+namespace esphome {
+namespace host {
+
+enum Level : int { NONE, ERROR, WARN, INFO, CONFIG, DEBUG, VERBOSE };
+
+extern int log_level;  // WARN, unless HOST_LOG_LEVEL is set in the environment (as a number)
+
+// if set, called with each message instead of printing it
+extern void (*log_hook)(int level, char const *tag, char const *message);
+
+void log(int level, char const *tag, char const *format, ...);
+
+}  // namespace host
+}  // namespace esphome
+
+#define ESP_LOG_AT_(level, tag, ...) \
+  do { \
+    if (::esphome::host::log_level >= (level)) \
+      ::esphome::host::log(level, tag, __VA_ARGS__); \
+  } while (false)
+#define ESP_LOGE(tag, ...) ESP_LOG_AT_(::esphome::host::ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESP_LOG_AT_(::esphome::host::WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESP_LOG_AT_(::esphome::host::INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ESP_LOG_AT_(::esphome::host::CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESP_LOG_AT_(::esphome::host::DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ESP_LOG_AT_(::esphome::host::VERBOSE, tag, __VA_ARGS__)
+
+#define LOG_SENSOR(prefix, type, sensor) \
+  do { \
+    if (sensor) \
+      ESP_LOGCONFIG(TAG, "%s%s '%s'", prefix, type, (sensor)->get_name()); \
+  } while (false)
+#define LOG_BINARY_SENSOR(prefix, type, sensor) LOG_SENSOR(prefix, type, sensor)
+#define LOG_TEXT_SENSOR(prefix, type, sensor) LOG_SENSOR(prefix, type, sensor)
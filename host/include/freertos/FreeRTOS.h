@@ -0,0 +1,17 @@
+#pragma once
+
+// FreeRTOS, as ESP-IDF configures it, over POSIX threads (shim/freertos.cpp)
+
+#include <cstdint>
+
+using BaseType_t = int;
+using UBaseType_t = unsigned;
+using TickType_t = std::uint32_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define portMAX_DELAY static_cast<TickType_t>(0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) static_cast<TickType_t>(ms)
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+#include "freertos/FreeRTOS.h"
+
+using QueueHandle_t = struct Queue *;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t size);
+void vQueueDelete(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, void const *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+
+using TaskHandle_t = struct Task *;
+using TaskFunction_t = void (*)(void *);
+
+// stack is in bytes, as in ESP-IDF. a host thread needs more: it gets a multiple of it, at least 64 KiB.
+BaseType_t xTaskCreate(TaskFunction_t function, char const *name, std::uint32_t stack, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *task);
+void vTaskDelete(TaskHandle_t task);  // only nullptr, the calling task
+void vTaskDelay(TickType_t ticks);
+
+// bytes of the stack of task (or the calling task) never used, as in ESP-IDF
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+// ^ and its size, which FreeRTOS does not have
+std::uint32_t host_task_stack_size(TaskHandle_t task);
+
+// ^ of each task ever created, by name: bytes of its stack used at most, and its size
+struct HostTaskStack {
+  std::string name;
+  std::uint32_t used;
+  std::uint32_t size;
+};
+std::vector<HostTaskStack> host_task_stacks();
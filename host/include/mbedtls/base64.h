@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+
+int mbedtls_base64_encode(unsigned char *destination, std::size_t size, std::size_t *length,
+                          unsigned char const *source, std::size_t source_length);
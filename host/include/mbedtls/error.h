@@ -0,0 +1,5 @@
+#pragma once
+
+#include <cstddef>
+
+void mbedtls_strerror(int error, char *buffer, std::size_t size);
@@ -0,0 +1,33 @@
+#pragma once
+
+// mbedTLS, as far as TLS goes on the host: through OpenSSL, with host::tls (see asio/ssl/stream.hpp),
+// and not at all without it, when asio/ssl/stream.hpp passes through in plain text.
+
+#include <cstddef>
+
+struct ssl_st;
+struct ssl_ctx_st;
+struct ssl_session_st;
+
+struct mbedtls_ssl_context {
+  char const *hostname;
+  ssl_ctx_st *configuration;  // of the asio::ssl::context of the stream
+  bool verify;                // the peer, with the certificate authorities of configuration
+  ssl_session_st *offer;      // for resumption, by the handshake
+  ssl_st *ssl;                // after the handshake
+};
+
+struct mbedtls_ssl_session {
+  ssl_session_st *session;
+  unsigned char id[32];
+  std::size_t id_len;
+};
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session);
+int mbedtls_ssl_get_session(mbedtls_ssl_context const *context, mbedtls_ssl_session *session);
+int mbedtls_ssl_set_session(mbedtls_ssl_context *context, mbedtls_ssl_session const *session);
+inline int mbedtls_ssl_set_hostname(mbedtls_ssl_context *context, char const *hostname) {
+  context->hostname = hostname;
+  return 0;
+}
@@ -0,0 +1,343 @@
+// Drive a ping_ Ping, as ESPHome runs it, with targets of different intervals (and probes) and report how it went:
+// probes sent and replied to (per second), heap allocations per probe, the largest burst of them beyond the rate
+// of its bucket and, with --toggle, the closest that two were sent after the targets were rephased.
+//
+//     ping_load --target icmp:127.0.0.1/200 --target icmp:127.0.0.2/300 --rate 10 --burst 2 --duration 5
+//
+// TCP and UDP targets without a port probe --port, such as that of config/probe_standin.py.
+//
+//     ping_load --port 7007 --target tcp:127.0.0.1/10 --target udp:127.0.0.1/10 --payload ping
+//
+// a --sweep of a network, every so many ms, sends its requests in batches of --batch (without a rate of its own),
+// which are counted with those of the targets. its changes are those of each sweep after the first.
+//
+//     ping_load --target icmp:127.0.0.1/200 --sweep 127.0.2.0/27/1000 --rate 20 --burst 2 --max-changes 0
+//
+// a probe is taken to be sent when the Ping says that it is sending it (at debug level).
+// its burst is how many more probes were sent in some window than the rate allows in it (and --slack more,
+// for the latency of the main loop). --toggle turns a target off, or back on, every so many ms, in turn,
+// each of which rephases the targets that are on. --spacing is the least time allowed between probes
+// while the same targets are on, as their phases should keep them apart.
+// the aggregate is that of the Ping at the end: none, some or all (of its targets up), or neither (if it has yet
+// to hear of a target).
+// exit status is 0 if no burst was larger than --burst (unless --rate is 0, which is unlimited),
+// no probes were closer than --spacing, the fraction of probes replied to was no less than --min-replied
+// and no more than --max-replied, the aggregate is --aggregate (if given) and the sweeps changed no more than
+// --max-changes (if given), 1 if not, 2 for bad arguments
+// and 77 (for ctest to skip) if
+// the Ping could not be set up, as it cannot without a raw ICMP socket (CAP_NET_RAW).
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "allocations.hpp"
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+#include "ping.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using esphome::ping_::Probe;
+
+struct Options {
+  std::vector<std::string> targets;  // probe:address[:port]/interval ms
+  std::vector<std::string> sweeps;   // address/prefix/interval ms
+  std::size_t batch{8};              // of sweep requests
+  std::uint16_t port{7007};          // of TCP and UDP targets that do not say
+  std::string payload;               // of UDP probes
+  double rate{0};                    // probes per second (0 is unlimited)
+  std::size_t burst{1};
+  unsigned timeout{100};     // ms of each probe
+  double duration{5};        // s
+  unsigned toggle{0};        // ms between turning targets off or on (0 is never)
+  double spacing{0};         // ms
+  double slack{5};           // ms
+  double min_replied{0};     // fraction of probes
+  double max_replied{1};     // fraction of probes
+  std::string aggregate;     // expected
+  double max_changes{HUGE_VAL};  // of sweeps, in all
+};
+
+template<typename T> bool parse(std::string_view const text, T &value) {
+  auto const [end, error]{std::from_chars(text.data(), text.data() + text.size(), value)};
+  return std::errc{} == error && end == text.data() + text.size();
+}
+
+bool parse(int const argc, char **const argv, Options &options) {
+  for (int i{1}; i < argc; ++i) {
+    std::string_view const name{argv[i]};
+    auto const number{[&](auto &value) { return i + 1 < argc && parse(argv[++i], value); }};
+    auto ok{true};
+    if ("--target" == name && i + 1 < argc) {
+      options.targets.emplace_back(argv[++i]);
+    } else if ("--sweep" == name && i + 1 < argc) {
+      options.sweeps.emplace_back(argv[++i]);
+    } else if ("--batch" == name) {
+      ok = number(options.batch);
+    } else if ("--port" == name) {
+      ok = number(options.port);
+    } else if ("--payload" == name && i + 1 < argc) {
+      options.payload = argv[++i];
+    } else if ("--rate" == name) {
+      ok = number(options.rate);
+    } else if ("--burst" == name) {
+      ok = number(options.burst);
+    } else if ("--timeout" == name) {
+      ok = number(options.timeout);
+    } else if ("--duration" == name) {
+      ok = number(options.duration);
+    } else if ("--toggle" == name) {
+      ok = number(options.toggle);
+    } else if ("--spacing" == name) {
+      ok = number(options.spacing);
+    } else if ("--slack" == name) {
+      ok = number(options.slack);
+    } else if ("--min-replied" == name) {
+      ok = number(options.min_replied);
+    } else if ("--max-replied" == name) {
+      ok = number(options.max_replied);
+    } else if ("--aggregate" == name && i + 1 < argc) {
+      options.aggregate = argv[++i];
+    } else if ("--max-changes" == name) {
+      ok = number(options.max_changes);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::fprintf(stderr, "bad argument %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options.targets.empty()) {
+    options.targets.emplace_back("icmp:127.0.0.1/100");
+  }
+  return true;
+}
+
+bool add_target(esphome::ping_::Ping &ping, esphome::ping_::Target &target, std::string_view const text,
+                Options const &options) {
+  // probe:address[:port]/interval
+  auto const colon{text.find(':')};
+  auto const slash{text.rfind('/')};
+  if (std::string_view::npos == colon || std::string_view::npos == slash || slash < colon) {
+    return false;
+  }
+  auto const name{text.substr(0, colon)};
+  auto address{text.substr(colon + 1, slash - colon - 1)};
+  unsigned interval;
+  if (!parse(text.substr(slash + 1), interval) || interval < options.timeout) {
+    return false;
+  }
+  auto probe{Probe::ICMP};
+  if ("tcp" == name) {
+    probe = Probe::TCP;
+  } else if ("udp" == name) {
+    probe = Probe::UDP;
+  } else if ("icmp" != name) {
+    return false;
+  }
+  if (Probe::ICMP != probe) {
+    auto port{options.port};
+    auto const port_colon{address.find(':')};
+    if (std::string_view::npos != port_colon) {
+      if (!parse(address.substr(port_colon + 1), port)) {
+        return false;
+      }
+      address = address.substr(0, port_colon);
+    }
+    target.set_port(port);
+    target.set_payload(options.payload);
+  }
+  esphome::network::IPAddress const ip{std::string{address}};
+  if (!ip.is_set()) {
+    return false;
+  }
+  target.set_name(std::string{text});
+  target.set_ping(&ping);
+  target.set_address(ip);
+  target.set_probe(probe);
+  target.set_interval(std::chrono::nanoseconds{std::chrono::milliseconds{interval}}.count());
+  target.set_timeout(std::chrono::nanoseconds{std::chrono::milliseconds{options.timeout}}.count());
+  return true;
+}
+
+bool add_sweep(esphome::ping_::Ping &ping, esphome::ping_::Sweep &sweep, std::string_view const text,
+               Options const &options) {
+  // address/prefix/interval
+  auto const slash{text.find('/')};
+  auto const interval_slash{text.rfind('/')};
+  if (std::string_view::npos == slash || slash == interval_slash) {
+    return false;
+  }
+  unsigned prefix, interval;
+  if (!parse(text.substr(slash + 1, interval_slash - slash - 1), prefix) || 32 < prefix ||
+      !parse(text.substr(interval_slash + 1), interval) || interval < options.timeout) {
+    return false;
+  }
+  esphome::network::IPAddress const ip{std::string{text.substr(0, slash)}};
+  if (!ip.is_set()) {
+    return false;
+  }
+  sweep.set_ping(&ping);
+  sweep.set_network(ip, static_cast<std::uint8_t>(prefix));
+  sweep.set_interval(std::chrono::nanoseconds{std::chrono::milliseconds{interval}}.count());
+  sweep.set_timeout(std::chrono::nanoseconds{std::chrono::milliseconds{options.timeout}}.count());
+  sweep.set_rate(0);  // bounded by the Ping alone
+  sweep.set_batch(options.batch);
+  return true;
+}
+
+// what the Ping said, as it said it
+int print_level{esphome::host::WARN};
+std::vector<Clock::time_point> sends;
+std::size_t replies{0};
+
+void hook(int const level, char const *const tag, char const *const message) {
+  std::string_view const text{message};
+  if (text.ends_with(" request") && std::string_view::npos != text.find(" sending ")) {
+    sends.push_back(Clock::now());
+  } else if (std::string_view::npos != text.find(" reply endpoint=")) {
+    ++replies;
+  }
+  if (level <= print_level) {
+    static constexpr char LETTERS[]{" EWICDV"};
+    std::printf("[%c][%s] %s\n", LETTERS[std::clamp(level, 0, static_cast<int>(esphome::host::VERBOSE))], tag,
+                message);
+  }
+}
+
+double milliseconds(Clock::duration const duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+int main(int const argc, char **const argv) {
+  Options options;
+  if (!parse(argc, argv, options)) {
+    return 2;
+  }
+
+  // a sweep says that it is sending each request at verbose level
+  print_level = esphome::host::log_level;
+  esphome::host::log_level = std::max(
+      print_level, static_cast<int>(options.sweeps.empty() ? esphome::host::DEBUG : esphome::host::VERBOSE));
+  esphome::host::log_hook = hook;
+
+  esphome::App.set_name("ping-load");
+  esphome::ping_::Ping ping;
+  ping.set_rate(static_cast<float>(options.rate));
+  ping.set_burst(options.burst);
+  esphome::binary_sensor::BinarySensor none{"none"};
+  esphome::binary_sensor::BinarySensor some{"some"};
+  esphome::binary_sensor::BinarySensor all{"all"};
+  ping.set_none(&none);
+  ping.set_some(&some);
+  ping.set_all(&all);
+  std::deque<esphome::ping_::Target> targets;
+  for (auto const &text : options.targets) {
+    if (!add_target(ping, targets.emplace_back(), text, options)) {
+      std::fprintf(stderr, "bad target %s\n", text.c_str());
+      return 2;
+    }
+  }
+  std::deque<esphome::ping_::Sweep> sweeps;
+  std::deque<esphome::sensor::Sensor> lives, changes;
+  double changed{0};
+  for (auto const &text : options.sweeps) {
+    auto &sweep{sweeps.emplace_back()};
+    if (!add_sweep(ping, sweep, text, options)) {
+      std::fprintf(stderr, "bad sweep %s\n", text.c_str());
+      return 2;
+    }
+    sweep.set_count(&lives.emplace_back(text + " live"));
+    sweep.set_changes(&changes.emplace_back(text + " changes"));
+    changes.back().add_on_state_callback([&changed](float const value) { changed += value; });
+  }
+
+  esphome::App.register_component(&ping);
+  esphome::App.setup();
+  if (ping.is_failed()) {
+    std::fprintf(stderr, "setup failed\n");
+    return 77;
+  }
+
+  // room for every probe, so that what we keep of them is not counted with what they allocate
+  sends.reserve(static_cast<std::size_t>(options.duration * 1e3) * targets.size() + 4096 * sweeps.size() + 1024);
+  std::vector<Clock::time_point> toggles;
+  toggles.reserve(options.toggle ? static_cast<std::size_t>(options.duration * 1e3 / options.toggle) + 1 : 0);
+  auto const start{Clock::now()};
+  auto const before{host::Allocations::now()};
+  auto const end{start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{options.duration})};
+  auto next_toggle{start + std::chrono::milliseconds{options.toggle}};
+  for (auto now{start}; now < end; now = Clock::now()) {
+    if (options.toggle && next_toggle <= now) {
+      // off, then back on, each target in turn
+      auto &target{targets[toggles.size() / 2 % targets.size()]};
+      if (target.state) {
+        target.turn_off();
+      } else {
+        target.turn_on();
+      }
+      toggles.push_back(now);
+      next_toggle += std::chrono::milliseconds{options.toggle};
+    }
+    esphome::App.loop();
+  }
+  auto const allocations{host::Allocations::now() - before};
+  auto const elapsed{std::chrono::duration<double>(Clock::now() - start).count()};
+  esphome::App.teardown(std::chrono::seconds{5});
+
+  // the largest excess of probes in any window over what the rate allows in it
+  double burst{0};
+  for (std::size_t i{0}; i < sends.size(); ++i) {
+    for (auto j{i}; j < sends.size(); ++j) {
+      auto const window{(milliseconds(sends[j] - sends[i]) + options.slack) / 1e3};
+      burst = std::max(burst, static_cast<double>(j - i + 1) - options.rate * window);
+    }
+  }
+  // the least time between probes while the same targets are on
+  auto spacing{HUGE_VAL};
+  auto toggle{toggles.begin()};
+  for (std::size_t i{1}; i < sends.size(); ++i) {
+    while (toggle != toggles.end() && *toggle <= sends[i - 1]) {
+      ++toggle;
+    }
+    if (toggle == toggles.end() || sends[i] < *toggle) {
+      spacing = std::min(spacing, milliseconds(sends[i] - sends[i - 1]));
+    }
+  }
+
+  auto const aggregate{none.state ? "none" : some.state ? "some" : all.state ? "all" : "neither"};
+  auto const probes{static_cast<double>(std::max<std::size_t>(sends.size(), 1))};
+  auto const replied{static_cast<double>(replies) / probes};
+  std::printf("probes %zu replies %zu in %.3f s: %.1f probes/s, %.1f replies/s\n", sends.size(), replies, elapsed,
+              static_cast<double>(sends.size()) / elapsed, static_cast<double>(replies) / elapsed);
+  std::printf("allocations %.1f per probe (%.0f bytes), target %zu bytes\n",
+              static_cast<double>(allocations.count) / probes, static_cast<double>(allocations.bytes) / probes,
+              sizeof(esphome::ping_::Target));
+  std::printf("burst %.2f of %zu at %.1f probes/s\n", burst, options.burst, options.rate);
+  std::printf("spacing %.1f ms over %zu toggles\n", spacing, toggles.size());
+  std::printf("aggregate %s\n", aggregate);
+  for (auto const &live : lives) {
+    std::printf("%s %.0f\n", live.get_name(), live.state);
+  }
+  if (!sweeps.empty()) {
+    std::printf("changes %.0f\n", changed);
+  }
+  auto const bursty{0 < options.rate && static_cast<double>(options.burst) < burst};
+  auto const crowded{spacing < options.spacing - options.slack};
+  auto const unreplied{replied < options.min_replied || options.max_replied < replied};
+  auto const unexpected{!options.aggregate.empty() && options.aggregate != aggregate};
+  auto const changing{options.max_changes < changed};
+  return bursty || crowded || unreplied || unexpected || changing ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+// Parse the replies of recorded SMTP transcripts (like those of transcripts/), as smtp_ does, and report how long
+// each took and what it allocated: positive replies, whose text is not kept, and the others, whose text is.
+//
+//     reply_bench --iterations 10000 transcripts/*.txt
+//
+// a transcript is the reply lines of sessions, without their CRLF, one to a line (as smtp_ logs them at debug
+// level, after "< "). empty lines and those that start with # are not replies.
+// exit status is 0 if every line was a reply line and no positive reply allocated, 1 if not
+// and 2 for bad arguments (or a transcript that could not be read).
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "allocations.hpp"
+#include "reply.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using esphome::smtp_::ReplyParser;
+
+// the lines of a reply and whether it is positive (2yz or 3yz)
+struct Recorded {
+  std::vector<std::string> lines;
+  bool positive;
+};
+
+bool read(char const *const path, std::vector<Recorded> &replies) {
+  std::ifstream file{path};
+  if (!file) {
+    return false;
+  }
+  Recorded reply{};
+  for (std::string line; std::getline(file, line);) {
+    if (line.empty() || line.starts_with('#')) {
+      continue;
+    }
+    reply.lines.push_back(line);
+    // the last line of a reply has a space (or nothing) after its code
+    if (line.size() <= 3 || '-' != line[3]) {
+      reply.positive = '2' == reply.lines.front()[0] || '3' == reply.lines.front()[0];
+      replies.push_back(std::move(reply));
+      reply = {};
+    }
+  }
+  if (!reply.lines.empty()) {
+    reply.positive = false;
+    replies.push_back(std::move(reply));
+  }
+  return true;
+}
+
+// parse a reply and tell whether it was positive (1) or not (0), or -1 if any of its lines were not reply lines
+int parse(Recorded const &recorded) {
+  ReplyParser parser{};
+  for (auto const &line : recorded.lines) {
+    if (!parser.line(line)) {
+      return -1;
+    }
+  }
+  auto const reply{std::move(parser).reply()};
+  return reply.is_positive_completion() || reply.is_positive_intermediate() ? 1 : 0;
+}
+
+}  // namespace
+
+int main(int const argc, char **const argv) {
+  unsigned iterations{10000};
+  std::vector<Recorded> replies;
+  for (int i{1}; i < argc; ++i) {
+    std::string_view const name{argv[i]};
+    if ("--iterations" == name && i + 1 < argc) {
+      std::string_view const text{argv[++i]};
+      auto const [end, error]{std::from_chars(text.data(), text.data() + text.size(), iterations)};
+      if (std::errc{} != error || end != text.data() + text.size()) {
+        std::fprintf(stderr, "bad argument %s\n", argv[i]);
+        return 2;
+      }
+    } else if (!read(argv[i], replies)) {
+      std::fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (replies.empty() || !iterations) {
+    std::fprintf(stderr, "no replies\n");
+    return 2;
+  }
+
+  // what each reply allocates, once, and whether it parses as recorded
+  std::size_t positives{0}, lines{0}, bad{0};
+  host::Allocations positive{}, other{};
+  for (auto const &reply : replies) {
+    auto const before{host::Allocations::now()};
+    auto const parsed{parse(reply)};
+    auto const allocations{host::Allocations::now() - before};
+    lines += reply.lines.size();
+    if (parsed < 0 || (1 == parsed) != reply.positive) {
+      ++bad;
+      continue;
+    }
+    auto &sum{reply.positive ? positive : other};
+    sum = {sum.count + allocations.count, sum.bytes + allocations.bytes};
+    positives += reply.positive;
+  }
+  auto const others{replies.size() - positives - bad};
+
+  // how long they take, all of them, again and again
+  std::size_t seen{0};
+  auto const start{Clock::now()};
+  for (unsigned i{0}; i < iterations; ++i) {
+    for (auto const &reply : replies) {
+      seen += static_cast<std::size_t>(parse(reply));
+    }
+  }
+  auto const elapsed{std::chrono::duration<double, std::nano>(Clock::now() - start).count()};
+  auto const parsed{static_cast<double>(iterations) * static_cast<double>(replies.size())};
+
+  std::printf("replies %zu (%zu lines): %zu positive, %zu other, %zu bad\n", replies.size(), lines, positives, others,
+              bad);
+  std::printf("%.1f ns per reply, %.1f ns per line (%zu positive of %.0f)\n", elapsed / parsed,
+              elapsed / (parsed * static_cast<double>(lines) / static_cast<double>(replies.size())), seen, parsed);
+  auto const per{[](host::Allocations const &sum, std::size_t const count) {
+    auto const n{static_cast<double>(std::max<std::size_t>(count, 1))};
+    std::printf("%.2f allocations per reply (%.0f bytes)", static_cast<double>(sum.count) / n,
+                static_cast<double>(sum.bytes) / n);
+  }};
+  std::printf("positive: ");
+  per(positive, positives);
+  std::printf("\nother: ");
+  per(other, others);
+  std::printf("\n");
+  return bad || positive.count ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+// count heap allocations, for measurements of how many each unit of work costs
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocations.hpp"
+
+namespace host {
+
+namespace {
+
+std::atomic<std::size_t> allocated{0};
+std::atomic<std::size_t> allocated_bytes{0};
+
+}  // namespace
+
+Allocations Allocations::now() {
+  return {allocated.load(std::memory_order_relaxed), allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+}  // namespace host
+
+void *operator new(std::size_t const size) {
+  host::allocated.fetch_add(1, std::memory_order_relaxed);
+  host::allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (auto *const pointer{std::malloc(size ? size : 1)}) {
+    return pointer;
+  }
+  std::abort();
+}
+
+void *operator new[](std::size_t const size) { return operator new(size); }
+void *operator new(std::size_t const size, std::nothrow_t const &) noexcept { return operator new(size); }
+void *operator new[](std::size_t const size, std::nothrow_t const &) noexcept { return operator new(size); }
+void operator delete(void *const pointer) noexcept { std::free(pointer); }
+void operator delete[](void *const pointer) noexcept { std::free(pointer); }
+void operator delete(void *const pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void *const pointer, std::size_t) noexcept { std::free(pointer); }
@@ -0,0 +1,17 @@
+#pragma once
+
+// heap allocations (by operator new) so far, in all threads, to difference around a measurement
+
+#include <cstddef>
+
+namespace host {
+
+struct Allocations {
+  std::size_t count;
+  std::size_t bytes;
+
+  static Allocations now();
+  Allocations operator-(Allocations const &before) const { return {count - before.count, bytes - before.bytes}; }
+};
+
+}  // namespace host
@@ -0,0 +1,142 @@
+// ESPHome, as host/include declares it: logging, the application and its scheduler, and helpers
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "esphome/core/application.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+
+namespace host {
+
+namespace {
+
+int initial_log_level() {
+  auto const *const value{std::getenv("HOST_LOG_LEVEL")};
+  return value ? std::atoi(value) : WARN;
+}
+
+}  // namespace
+
+int log_level{initial_log_level()};
+void (*log_hook)(int level, char const *tag, char const *message){nullptr};
+
+void log(int const level, char const *const tag, char const *const format, ...) {
+  char message[512];
+  va_list arguments;
+  va_start(arguments, format);
+  std::vsnprintf(message, sizeof message, format, arguments);
+  va_end(arguments);
+  if (log_hook) {
+    log_hook(level, tag, message);
+    return;
+  }
+  static constexpr char LETTERS[]{" EWICDV"};
+  std::printf("[%c][%s] %s\n", LETTERS[std::clamp(level, 0, static_cast<int>(VERBOSE))], tag, message);
+  std::fflush(stdout);
+}
+
+}  // namespace host
+
+Application App;
+
+void Application::setup() {
+  std::ranges::stable_sort(this->components_, [](Component const *const a, Component const *const b) {
+    return a->get_setup_priority() > b->get_setup_priority();
+  });
+  for (auto *const component : this->components_) {
+    component->setup();
+    if (auto *const polling{dynamic_cast<PollingComponent *>(component)}) {
+      this->set_interval(component, "update", polling->get_update_interval(), [polling]() { polling->update(); });
+    }
+  }
+  for (auto *const component : this->components_) {
+    component->dump_config();
+  }
+}
+
+void Application::loop() {
+  for (auto *const component : this->components_) {
+    if (!component->is_failed()) {
+      component->loop();
+    }
+  }
+  std::vector<std::function<void()>> deferred;
+  {
+    std::lock_guard const lock{this->mutex_};
+    deferred.swap(this->deferred_);
+  }
+  for (auto const &function : deferred) {
+    function();
+  }
+  auto const now{std::chrono::steady_clock::now()};
+  while (!this->items_.empty() && this->items_.front().due <= now) {
+    auto item{std::move(this->items_.front())};
+    this->items_.pop_front();
+    item.function();
+    if (item.interval.count()) {
+      item.due += item.interval;
+      this->schedule(std::move(item));
+    }
+  }
+}
+
+bool Application::teardown(std::chrono::milliseconds const timeout) {
+  auto const deadline{std::chrono::steady_clock::now() + timeout};
+  auto pending{this->components_};
+  while (!pending.empty() && std::chrono::steady_clock::now() < deadline) {
+    std::erase_if(pending, [](Component *const component) { return component->teardown(); });
+    this->loop();
+  }
+  return pending.empty();
+}
+
+void Application::defer(std::function<void()> &&function) {
+  std::lock_guard const lock{this->mutex_};
+  this->deferred_.push_back(std::move(function));
+}
+
+void Application::set_interval(Component *const component, std::string const &name, std::uint32_t const interval,
+                               std::function<void()> &&function) {
+  std::chrono::milliseconds const period{interval};
+  this->schedule({component, name, std::chrono::steady_clock::now() + period, period, std::move(function)});
+}
+
+void Application::set_timeout(Component *const component, std::string const &name, std::uint32_t const timeout,
+                              std::function<void()> &&function) {
+  this->schedule({component, name, std::chrono::steady_clock::now() + std::chrono::milliseconds{timeout},
+                  std::chrono::milliseconds{0}, std::move(function)});
+}
+
+void Application::schedule(Item &&item) {
+  std::erase_if(this->items_, [&item](Item const &other) {
+    return other.component == item.component && other.name == item.name;
+  });
+  auto const later{std::ranges::find_if(this->items_, [&item](Item const &other) { return item.due < other.due; })};
+  this->items_.insert(later, std::move(item));
+}
+
+void Component::defer(std::function<void()> &&function) { App.defer(std::move(function)); }
+
+void Component::set_interval(std::string const &name, std::uint32_t const interval, std::function<void()> &&function) {
+  App.set_interval(this, name, interval, std::move(function));
+}
+
+void Component::set_timeout(std::string const &name, std::uint32_t const timeout, std::function<void()> &&function) {
+  App.set_timeout(this, name, timeout, std::move(function));
+}
+
+std::uint32_t random_uint32() {
+  static thread_local std::mt19937 generator{std::random_device{}()};
+  return generator();
+}
+
+std::string get_mac_address() { return "02005e000001"; }
+
+}  // namespace esphome
@@ -0,0 +1,170 @@
+// FreeRTOS, as host/include declares it: a task is a POSIX thread on a stack of our own,
+// painted so that its high water mark can be found, and a queue is a mutex and condition variable.
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+struct Task {
+  TaskFunction_t function;
+  void *parameter;
+  unsigned char *stack;  // lowest address, above the guard page
+  std::size_t size;
+  std::string name;
+};
+
+struct Queue {
+  std::size_t length;
+  std::size_t size;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::vector<unsigned char>> items;
+};
+
+namespace {
+
+constexpr std::size_t STACK_SCALE{8};         // x86-64 frames, unoptimized, are larger than those of the device
+constexpr std::size_t STACK_MINIMUM{1 << 16};  // bytes
+constexpr unsigned char PAINT{0xa5};
+
+thread_local Task *current{nullptr};
+
+std::mutex tasks_mutex;
+std::vector<Task *> tasks;  // ever created
+
+void *run(void *const task) {
+  current = static_cast<Task *>(task);
+  current->function(current->parameter);
+  return nullptr;
+}
+
+template<typename Predicate>
+bool wait(std::unique_lock<std::mutex> &lock, std::condition_variable &changed, TickType_t const ticks,
+          Predicate predicate) {
+  if (portMAX_DELAY == ticks) {
+    changed.wait(lock, predicate);
+    return true;
+  }
+  return changed.wait_for(lock, std::chrono::milliseconds{ticks * portTICK_PERIOD_MS}, predicate);
+}
+
+}  // namespace
+
+BaseType_t xTaskCreate(TaskFunction_t const function, char const *const name, std::uint32_t const stack,
+                       void *const parameter, UBaseType_t, TaskHandle_t *const task) {
+  auto const page{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+  auto const size{(std::max(stack * STACK_SCALE, STACK_MINIMUM) + page - 1) / page * page};
+  auto *const mapping{static_cast<unsigned char *>(
+      mmap(nullptr, size + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0))};
+  if (MAP_FAILED == static_cast<void *>(mapping)) {
+    return pdFAIL;
+  }
+  mprotect(mapping, page, PROT_NONE);  // to fault on overflow rather than corrupt
+  // never freed: a task may delete itself while on this stack
+  auto *const created{new Task{function, parameter, mapping + page, size, name}};
+  std::memset(created->stack, PAINT, size);
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstack(&attributes, created->stack, size);
+  pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+  pthread_t thread;
+  auto const error{pthread_create(&thread, &attributes, &run, created)};
+  pthread_attr_destroy(&attributes);
+  if (error) {
+    return pdFAIL;
+  }
+  pthread_setname_np(thread, std::string{name}.substr(0, 15).c_str());
+  {
+    std::lock_guard const lock{tasks_mutex};
+    tasks.push_back(created);
+  }
+  if (task) {
+    *task = created;
+  }
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t const task) {
+  if (!task || task == current) {
+    pthread_exit(nullptr);
+  }
+}
+
+void vTaskDelay(TickType_t const ticks) { std::this_thread::sleep_for(std::chrono::milliseconds{ticks}); }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  task = task ? task : current;
+  if (!task) {
+    return 0;
+  }
+  // the stack grows down, from stack + size
+  auto const *const end{task->stack + task->size};
+  auto const *const used{std::find_if(static_cast<unsigned char const *>(task->stack), end, [](unsigned char const c) { return PAINT != c; })};
+  return static_cast<UBaseType_t>(used - task->stack);
+}
+
+std::uint32_t host_task_stack_size(TaskHandle_t task) {
+  task = task ? task : current;
+  return task ? static_cast<std::uint32_t>(task->size) : 0;
+}
+
+std::vector<HostTaskStack> host_task_stacks() {
+  std::lock_guard const lock{tasks_mutex};
+  std::vector<HostTaskStack> stacks;
+  for (auto *const task : tasks) {
+    stacks.push_back({task->name, static_cast<std::uint32_t>(task->size - uxTaskGetStackHighWaterMark(task)),
+                      static_cast<std::uint32_t>(task->size)});
+  }
+  return stacks;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t const length, UBaseType_t const size) {
+  return new Queue{length, size, {}, {}, {}};
+}
+
+void vQueueDelete(QueueHandle_t const queue) { delete queue; }
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t const queue) {
+  std::lock_guard const lock{queue->mutex};
+  return static_cast<UBaseType_t>(queue->length - queue->items.size());
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t const queue) {
+  std::lock_guard const lock{queue->mutex};
+  return static_cast<UBaseType_t>(queue->items.size());
+}
+
+BaseType_t xQueueSend(QueueHandle_t const queue, void const *const item, TickType_t const ticks) {
+  std::unique_lock lock{queue->mutex};
+  if (!wait(lock, queue->changed, ticks, [queue]() { return queue->items.size() < queue->length; })) {
+    return pdFALSE;
+  }
+  auto const *const bytes{static_cast<unsigned char const *>(item)};
+  queue->items.emplace_back(bytes, bytes + queue->size);
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t const queue, void *const item, TickType_t const ticks) {
+  std::unique_lock lock{queue->mutex};
+  if (!wait(lock, queue->changed, ticks, [queue]() { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+  std::memcpy(item, queue->items.front().data(), queue->size);
+  queue->items.pop_front();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
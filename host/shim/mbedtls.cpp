@@ -0,0 +1,209 @@
+// mbedTLS, as host/include declares it, and the handshake that asio::ssl::stream stands in for:
+// with host::tls, that of OpenSSL, with a BIO through the next layer of the stream.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <asio/error.hpp>
+
+#include "asio/ssl/stream.hpp"
+#include "mbedtls/base64.h"
+#include "mbedtls/error.h"
+
+std::chrono::milliseconds host::handshake{0};
+bool host::tls{false};
+
+namespace {
+
+// what a read or write of the next layer says to a BIO of it: that it would block is to retry (when it does not)
+bool retry(std::error_code const &ec) { return ec == asio::error::would_block || ec == asio::error::try_again; }
+
+// a BIO through the host::Layer that is its data
+BIO_METHOD *layer_method() {
+  static BIO_METHOD *const method{[] {
+    auto *const layer{BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "asio next layer")};
+    BIO_meth_set_write(layer, [](BIO *const bio, char const *const data, int const size) -> int {
+      auto &next{*static_cast<host::Layer *>(BIO_get_data(bio))};
+      BIO_clear_retry_flags(bio);
+      auto const written{next.write_some(next.stream, asio::const_buffer(data, static_cast<std::size_t>(size)),
+                                         next.error)};
+      if (retry(next.error)) {
+        BIO_set_retry_write(bio);
+      }
+      return next.error ? -1 : static_cast<int>(written);
+    });
+    BIO_meth_set_read(layer, [](BIO *const bio, char *const data, int const size) -> int {
+      auto &next{*static_cast<host::Layer *>(BIO_get_data(bio))};
+      BIO_clear_retry_flags(bio);
+      auto const read{next.read_some(next.stream, asio::mutable_buffer(data, static_cast<std::size_t>(size)),
+                                     next.error)};
+      if (retry(next.error)) {
+        BIO_set_retry_read(bio);
+      }
+      return next.error == asio::error::eof ? 0 : next.error ? -1 : static_cast<int>(read);
+    });
+    BIO_meth_set_ctrl(layer, [](BIO *, int const command, long, void *) -> long { return BIO_CTRL_FLUSH == command; });
+    return layer;
+  }()};
+  return method;
+}
+
+// what a TLS operation that did not succeed waits for, or its error
+std::error_code error(ssl_st *const ssl, int const result, host::Want &want) {
+  auto const &next{*static_cast<host::Layer const *>(BIO_get_data(SSL_get_rbio(ssl)))};
+  switch (SSL_get_error(ssl, result)) {
+    case SSL_ERROR_WANT_READ:
+      want = host::Want::READ;
+      return {};
+    case SSL_ERROR_WANT_WRITE:
+      want = host::Want::WRITE;
+      return {};
+    case SSL_ERROR_ZERO_RETURN:
+      return asio::error::eof;
+    case SSL_ERROR_SYSCALL:
+      return next.error ? next.error : asio::error::eof;
+    default:
+      for (unsigned long code; (code = ERR_get_error());) {
+        std::fprintf(stderr, "tls: %s\n", ERR_error_string(code, nullptr));
+      }
+      return std::make_error_code(std::errc::protocol_error);
+  }
+}
+
+}  // namespace
+
+asio::ssl::context::context(method) : context_{SSL_CTX_new(TLS_client_method())} {
+  SSL_CTX_set_max_proto_version(this->context_, TLS1_2_VERSION);
+}
+
+asio::ssl::context::~context() { SSL_CTX_free(this->context_); }
+
+void asio::ssl::context::add_certificate_authority(const_buffer const &certificate, std::error_code &ec) {
+  auto *const bio{BIO_new_mem_buf(certificate.data(), static_cast<int>(certificate.size()))};
+  auto *const x509{PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)};
+  BIO_free(bio);
+  ec = x509 && X509_STORE_add_cert(SSL_CTX_get_cert_store(this->context_), x509)
+           ? std::error_code{}
+           : std::make_error_code(std::errc::invalid_argument);
+  X509_free(x509);
+}
+
+std::error_code host::tls_handshake(mbedtls_ssl_context &context, Layer &layer) {
+  SSL_free(context.ssl);
+  context.ssl = SSL_new(context.configuration);
+  auto *const bio{BIO_new(layer_method())};
+  BIO_set_data(bio, &layer);
+  BIO_set_init(bio, 1);
+  SSL_set_bio(context.ssl, bio, bio);
+  SSL_set_mode(context.ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+  SSL_set_verify(context.ssl, context.verify ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, nullptr);
+  if (context.hostname) {
+    SSL_set_tlsext_host_name(context.ssl, context.hostname);
+    if (context.verify) {
+      SSL_set1_host(context.ssl, context.hostname);
+    }
+  }
+  if (context.offer) {
+    SSL_set_session(context.ssl, context.offer);
+  }
+  // the next layer blocks, as it does on the device, so nothing is wanted of it
+  auto const result{SSL_connect(context.ssl)};
+  if (1 != result) {
+    auto want{Want::NOTHING};
+    auto ec{error(context.ssl, result, want)};
+    SSL_free(context.ssl);
+    context.ssl = nullptr;
+    return ec ? ec : asio::error::would_block;
+  }
+  return {};
+}
+
+std::size_t host::tls_read(mbedtls_ssl_context &context, asio::mutable_buffer const buffer, std::error_code &ec,
+                           Want &want) {
+  std::size_t size{0};
+  auto const result{SSL_read_ex(context.ssl, buffer.data(), buffer.size(), &size)};
+  ec = 0 < result ? std::error_code{} : error(context.ssl, result, want);
+  return size;
+}
+
+std::size_t host::tls_write(mbedtls_ssl_context &context, asio::const_buffer const buffer, std::error_code &ec,
+                            Want &want) {
+  std::size_t size{0};
+  auto const result{SSL_write_ex(context.ssl, buffer.data(), buffer.size(), &size)};
+  ec = 0 < result ? std::error_code{} : error(context.ssl, result, want);
+  return size;
+}
+
+void host::tls_shutdown(mbedtls_ssl_context &context) {
+  if (context.ssl) {
+    SSL_shutdown(context.ssl);
+    ERR_clear_error();
+  }
+}
+
+void host::tls_free(mbedtls_ssl_context &context) {
+  SSL_free(context.ssl);
+  context.ssl = nullptr;
+  SSL_SESSION_free(context.offer);
+  context.offer = nullptr;
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *const session) { *session = {}; }
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session *const session) {
+  SSL_SESSION_free(session->session);
+  *session = {};
+}
+
+int mbedtls_ssl_get_session(mbedtls_ssl_context const *const context, mbedtls_ssl_session *const session) {
+  // of no TLS (as in plain text), a session of no id, which is no more to resume than one of a server without
+  session->session = context->ssl ? SSL_get1_session(context->ssl) : nullptr;
+  unsigned length{0};
+  auto const *const id{session->session ? SSL_SESSION_get_id(session->session, &length) : nullptr};
+  session->id_len = std::min<std::size_t>(length, sizeof session->id);
+  std::copy_n(id, session->id_len, session->id);
+  return 0;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context *const context, mbedtls_ssl_session const *const session) {
+  if (session->session) {
+    SSL_SESSION_up_ref(session->session);
+  }
+  SSL_SESSION_free(context->offer);
+  context->offer = session->session;
+  return 0;
+}
+
+void mbedtls_strerror(int const error, char *const buffer, std::size_t const size) {
+  std::snprintf(buffer, size, "mbedtls error -0x%04x", static_cast<unsigned>(-error));
+}
+
+int mbedtls_base64_encode(unsigned char *const destination, std::size_t const size, std::size_t *const length,
+                          unsigned char const *const source, std::size_t const source_length) {
+  static constexpr char ALPHABET[]{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"};
+  auto const needed{(source_length + 2) / 3 * 4};
+  if (size < needed + 1) {
+    *length = needed + 1;
+    return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  }
+  auto *out{destination};
+  for (std::size_t i{0}; i < source_length; i += 3) {
+    unsigned const a{source[i]};
+    unsigned const b{i + 1 < source_length ? source[i + 1] : 0u};
+    unsigned const c{i + 2 < source_length ? source[i + 2] : 0u};
+    *out++ = static_cast<unsigned char>(ALPHABET[a >> 2]);
+    *out++ = static_cast<unsigned char>(ALPHABET[(a & 3) << 4 | b >> 4]);
+    *out++ = static_cast<unsigned char>(i + 1 < source_length ? ALPHABET[(b & 15) << 2 | c >> 6] : '=');
+    *out++ = static_cast<unsigned char>(i + 2 < source_length ? ALPHABET[c & 63] : '=');
+  }
+  *out = 0;
+  *length = needed;
+  return 0;
+}
@@ -0,0 +1,500 @@
+// Drive an smtp_ Component, as ESPHome runs it, with messages for relays (like config/smtp_standin.py)
+// and report how it went: messages per second, percentiles of delivery latency, heap allocations and CPU time
+// per message (with --interval, lest it count the spin between main loops), how long each main loop took
+// and how much of its stack each task used.
+//
+//     smtp_load --relay 127.0.0.1:2525 --messages 1000 --size 4096
+//
+// delivery latency is from enqueue to retirement, as the queue depth sensor tells it on the main loop:
+// each time it goes down, the oldest message outstanding is taken to be done (which it is, but for
+// retries or, with more than one relay, nearly so). with --spool, messages replayed from it are delivered too.
+// with --connects, it also reports how long each connect took (with its resolve) and the hit rate of the resolve
+// cache, from what the component says of them at info level (as it then says of each message, which costs some).
+// with --tls, the relays are of STARTTLS (like config/smtp_standin.py with a certificate), whose handshakes are of
+// TLS through OpenSSL, and it reports how long they took and the bytes of them, full and resumed, likewise.
+// exit status is 0 if all messages were delivered (or no more than --dead were dead-lettered) before --timeout,
+// at no less than --min-rate messages per second, no more than --max-allocations per message and with main loops
+// that took no more than --max-busy ms in all (and, with --connects, a resolve cache hit rate of no less than
+// --min-hit-rate and, with --tls, no less than --min-resumed and no more than --max-resumed of the handshakes
+// after the first resumed),
+// 1 if not and 2 for bad arguments.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "allocations.hpp"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+#include "freertos/task.h"
+#include "multipart.hpp"
+#include "smtp.hpp"
+#include "spool.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using esphome::smtp_::Transport;
+
+constexpr std::size_t LOOP_SAMPLES{1 << 20};  // main loop times kept, at most
+
+struct Options {
+  std::vector<std::string> relays;  // host:port[/transport[/path]], in order of preference
+  bool shard{false};
+  std::size_t messages{1000};
+  std::size_t window{16};  // messages outstanding at once, closed loop
+  double rate{0};          // messages enqueued per second, open loop, instead of window
+  std::size_t size{512};   // of each body
+  std::size_t attach{0};   // bytes of an attachment, so that the body is produced instead
+  unsigned idle{1000};     // ms a session is kept open for more messages
+  unsigned retry{100};     // ms of the initial backoff after a failed session
+  unsigned digest{0};      // ms to collect messages for, to fold them into one (0 is never)
+  bool threaded{false};
+  unsigned interval{0};  // ms between main loops
+  unsigned timeout{60};  // s
+  std::size_t dead{0};   // messages that may be dead-lettered
+  unsigned handshake{0};  // ms each TLS handshake blocks, as it does on the device
+  std::string spool;      // file
+  double min_rate{0};     // messages delivered per second, at least
+  double max_busy{0};     // ms of main loops in all, at most (0 is unlimited)
+  double max_allocations{0};  // per message, at most (0 is unlimited)
+  long long resolve_ttl{-1};  // ms (or that of the component, if negative)
+  bool connects{false};       // to report, from what the component says of each (at info level)
+  double min_hit_rate{0};     // of the resolve cache, at least
+  bool tls{false};            // of STARTTLS, and to report its handshakes as connects are
+  double min_resumed{0};      // of handshakes after the first, at least
+  double max_resumed{1};      // of handshakes after the first, at most
+};
+
+template<typename T> bool parse(std::string_view const text, T &value) {
+  auto const [end, error]{std::from_chars(text.data(), text.data() + text.size(), value)};
+  return std::errc{} == error && end == text.data() + text.size();
+}
+
+bool parse(int const argc, char **const argv, Options &options) {
+  for (int i{1}; i < argc; ++i) {
+    std::string_view const name{argv[i]};
+    auto const flag{[&](bool &value) {
+      value = true;
+      return true;
+    }};
+    auto const number{[&](auto &value) { return i + 1 < argc && parse(argv[++i], value); }};
+    auto ok{true};
+    if ("--relay" == name && i + 1 < argc) {
+      options.relays.emplace_back(argv[++i]);
+    } else if ("--shard" == name) {
+      ok = flag(options.shard);
+    } else if ("--messages" == name) {
+      ok = number(options.messages);
+    } else if ("--window" == name) {
+      ok = number(options.window);
+    } else if ("--rate" == name) {
+      ok = number(options.rate);
+    } else if ("--size" == name) {
+      ok = number(options.size);
+    } else if ("--attach" == name) {
+      ok = number(options.attach);
+    } else if ("--idle" == name) {
+      ok = number(options.idle);
+    } else if ("--retry" == name) {
+      ok = number(options.retry);
+    } else if ("--digest" == name) {
+      ok = number(options.digest);
+    } else if ("--threaded" == name) {
+      ok = flag(options.threaded);
+    } else if ("--interval" == name) {
+      ok = number(options.interval);
+    } else if ("--timeout" == name) {
+      ok = number(options.timeout);
+    } else if ("--dead" == name) {
+      ok = number(options.dead);
+    } else if ("--handshake" == name) {
+      ok = number(options.handshake);
+    } else if ("--min-rate" == name) {
+      ok = number(options.min_rate);
+    } else if ("--max-busy" == name) {
+      ok = number(options.max_busy);
+    } else if ("--max-allocations" == name) {
+      ok = number(options.max_allocations);
+    } else if ("--resolve-ttl" == name) {
+      ok = number(options.resolve_ttl);
+    } else if ("--connects" == name) {
+      ok = flag(options.connects);
+    } else if ("--min-hit-rate" == name) {
+      ok = number(options.min_hit_rate);
+    } else if ("--tls" == name) {
+      ok = flag(options.tls);
+    } else if ("--min-resumed" == name) {
+      ok = number(options.min_resumed);
+    } else if ("--max-resumed" == name) {
+      ok = number(options.max_resumed);
+    } else if ("--spool" == name && i + 1 < argc) {
+      options.spool = argv[++i];
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::fprintf(stderr, "bad argument %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options.relays.empty()) {
+    options.relays.emplace_back("127.0.0.1:2525");
+  }
+  return true;
+}
+
+bool add_relay(esphome::smtp_::Component &component, std::string_view const relay) {
+  // host:port[/transport[/path]]
+  auto const colon{relay.find(':')};
+  if (std::string_view::npos == colon) {
+    return false;
+  }
+  auto rest{relay.substr(colon + 1)};
+  auto const slash{rest.find('/')};
+  std::uint16_t port;
+  if (!parse(rest.substr(0, slash), port)) {
+    return false;
+  }
+  auto transport{Transport::SMTP};
+  std::string path;
+  if (std::string_view::npos != slash) {
+    rest.remove_prefix(slash + 1);
+    auto const name{rest.substr(0, rest.find('/'))};
+    if ("syslog" == name) {
+      transport = Transport::SYSLOG;
+    } else if ("webhook" == name) {
+      transport = Transport::WEBHOOK;
+    } else if ("mqtt" == name) {
+      transport = Transport::MQTT;
+    } else if ("smtp" != name) {
+      return false;
+    }
+    if (name.size() < rest.size()) {
+      path = rest.substr(name.size() + 1);
+    }
+  }
+  component.add_relay(std::string{relay.substr(0, colon)}, port, transport, path);
+  return true;
+}
+
+// a body of size bytes, in lines of text, some of which begin with a dot to be stuffed
+std::string body(std::size_t const size) {
+  std::string text;
+  text.reserve(size);
+  for (std::size_t line{0}; text.size() < size; ++line) {
+    auto const start{text.size()};
+    if (0 == line % 8) {
+      text += '.';
+    }
+    while (text.size() < start + 70) {
+      text += static_cast<char>('a' + (text.size() + line) % 26);
+    }
+    text += "\r\n";
+  }
+  text.resize(size);
+  return text;
+}
+
+double milliseconds(Clock::duration const duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// ns of CPU time, of the process or the calling thread
+double cpu(clockid_t const clock) {
+  timespec time;
+  clock_gettime(clock, &time);
+  return static_cast<double>(time.tv_sec) * 1e9 + static_cast<double>(time.tv_nsec);
+}
+
+template<typename T> T percentile(std::vector<T> values, double const fraction) {
+  if (values.empty()) {
+    return {};
+  }
+  auto const index{static_cast<std::size_t>(fraction * static_cast<double>(values.size() - 1))};
+  std::ranges::nth_element(values, values.begin() + static_cast<std::ptrdiff_t>(index));
+  return values[index];
+}
+
+// each connect, as the component says it: how long it took to resolve and connect, and its resolve cache so far
+struct Connects {
+  std::mutex mutex;               // of what the task of a threaded component says
+  std::vector<double> latencies;  // ms of resolve and connect
+  std::vector<double> resolves;   // ms
+  unsigned hits{0};
+  unsigned misses{0};
+} connects;
+
+// each TLS handshake, as the component says it: full or resumed, how long it took and its bytes
+struct Handshakes {
+  struct Kind {
+    std::vector<double> latencies;  // ms
+    std::size_t sent{0};
+    std::size_t received{0};
+  };
+  std::mutex mutex;  // of what the task of a threaded component says
+  Kind full;
+  Kind resumed;
+} handshakes;
+int print_level{esphome::host::WARN};
+
+void hook(int const level, char const *const tag, char const *const message) {
+  long long connect, resolve;
+  unsigned hits, misses;
+  char kind[32];
+  long long latency;
+  std::size_t sent, received;
+  if (4 == std::sscanf(message, "handshake (%31[^)]) %lld ms, %zu bytes sent, %zu received", kind, &latency, &sent,
+                       &received)) {
+    std::lock_guard const lock{handshakes.mutex};
+    auto &counted{std::string_view{"resumed"} == kind ? handshakes.resumed : handshakes.full};
+    counted.latencies.push_back(static_cast<double>(latency));
+    counted.sent += sent;
+    counted.received += received;
+  }
+  if (4 == std::sscanf(message, "connect %*s %lld us (resolve %lld us, cache %u hits, %u misses)", &connect, &resolve,
+                       &hits, &misses)) {
+    std::lock_guard const lock{connects.mutex};
+    connects.latencies.push_back(static_cast<double>(connect + resolve) / 1e3);
+    connects.resolves.push_back(static_cast<double>(resolve) / 1e3);
+    connects.hits = hits;
+    connects.misses = misses;
+  }
+  if (level <= print_level) {
+    static constexpr char LETTERS[]{" EWICDV"};
+    std::printf("[%c][%s] %s\n", LETTERS[std::clamp(level, 0, static_cast<int>(esphome::host::VERBOSE))], tag,
+                message);
+    std::fflush(stdout);
+  }
+}
+
+}  // namespace
+
+int main(int const argc, char **const argv) {
+  Options options;
+  if (!parse(argc, argv, options)) {
+    return 2;
+  }
+
+  host::handshake = std::chrono::milliseconds{options.handshake};
+  host::tls = options.tls;
+  if (options.connects || options.tls) {
+    // which costs each message the formatting of what the component says of it at info level
+    print_level = esphome::host::log_level;
+    esphome::host::log_level = std::max(print_level, static_cast<int>(esphome::host::INFO));
+    esphome::host::log_hook = hook;
+    connects.latencies.reserve(options.messages + 1024);
+    connects.resolves.reserve(options.messages + 1024);
+  }
+  esphome::App.set_name("smtp-load");
+  esphome::smtp_::Component component;
+  for (auto const &relay : options.relays) {
+    if (!add_relay(component, relay)) {
+      std::fprintf(stderr, "bad relay %s\n", relay.c_str());
+      return 2;
+    }
+  }
+  component.set_shard(options.shard);
+  component.set_username("load");
+  component.set_password("load");  // which the stand-ins take, whatever it is
+  component.set_from("load@smtp-load.invalid");
+  component.set_to("sink@smtp-load.invalid");
+  // implicit TLS passes through on the host, or STARTTLS is through OpenSSL
+  component.set_starttls(options.tls);
+  component.set_idle(std::chrono::nanoseconds{std::chrono::milliseconds{options.idle}}.count());
+  // and room for all that the spool (of 64 KiB on the host) may replay
+  component.set_capacity(std::max(options.window, options.messages) + (options.spool.empty() ? 0 : 4096));
+  component.set_retry_initial(std::chrono::nanoseconds{std::chrono::milliseconds{options.retry}}.count());
+  component.set_digest(std::chrono::nanoseconds{std::chrono::milliseconds{options.digest}}.count());
+  component.set_retry_maximum(std::chrono::nanoseconds{std::chrono::milliseconds{options.retry * 8}}.count());
+  component.set_threaded(options.threaded);
+  if (0 <= options.resolve_ttl) {
+    component.set_resolve_ttl(std::chrono::nanoseconds{std::chrono::milliseconds{options.resolve_ttl}}.count());
+  }
+  if (!options.spool.empty()) {
+    component.set_spool(options.spool);
+  }
+  esphome::sensor::Sensor depth{"depth"};
+  esphome::sensor::Sensor dead{"dead"};
+  component.set_depth(&depth);
+  component.set_dead(&dead);
+
+  // retirements, in order of enqueue, as the depth goes down
+  std::deque<Clock::time_point> outstanding;
+  std::vector<double> latencies;
+  latencies.reserve(options.messages);
+  std::size_t retired{0};
+  std::size_t dead_letters{0};
+  std::size_t unmeasured{0};  // retirements to come that were dead letters
+  std::size_t refused{0};     // dead letters to come that were never queued, too large to spool
+  std::size_t last_depth{0};
+  depth.add_on_state_callback([&](float const state) {
+    auto const now{Clock::now()};
+    auto const value{static_cast<std::size_t>(state)};
+    for (; value < last_depth && !outstanding.empty(); --last_depth) {
+      if (unmeasured) {
+        --unmeasured;
+      } else {
+        latencies.push_back(milliseconds(now - outstanding.front()));
+      }
+      outstanding.pop_front();
+      ++retired;
+    }
+    last_depth = value;
+  });
+  dead.add_on_state_callback([&](float const state) {
+    auto const value{static_cast<std::size_t>(state)};
+    auto const letters{value - dead_letters};
+    auto const unqueued{std::min(letters, refused)};
+    refused -= unqueued;
+    unmeasured += letters - unqueued;
+    dead_letters = value;
+  });
+
+  esphome::App.register_component(&component);
+  esphome::App.setup();
+  if (component.is_failed()) {
+    std::fprintf(stderr, "setup failed\n");
+    return 1;
+  }
+  esphome::App.loop();  // to publish the depth of what was replayed
+  auto const replayed{depth.has_state() ? static_cast<std::size_t>(depth.state) : 0};
+  outstanding.resize(replayed, Clock::now());
+  auto const total{options.messages + replayed};
+  std::printf("replayed %zu\n", replayed);
+
+  auto const content{body(options.size)};
+  auto const produced{[&options]() {
+    auto multipart{std::make_unique<esphome::smtp_::Multipart>("load, attached")};
+    multipart->attach("load.csv", "text/csv",
+                      [size = options.attach](std::size_t const index, std::span<char> const buffer) -> std::size_t {
+                        auto const offset{index * buffer.size()};
+                        if (size <= offset) {
+                          return 0;
+                        }
+                        auto const length{std::min(buffer.size(), size - offset)};
+                        for (std::size_t i{0}; i < length; ++i) {
+                          buffer[i] = (offset + i) % 32 == 31 ? '\n' : static_cast<char>('0' + (offset + i) % 10);
+                        }
+                        return length;
+                      });
+    return multipart;
+  }};
+
+  std::vector<std::uint32_t> loops;  // ns each
+  loops.reserve(LOOP_SAMPLES);
+  std::size_t enqueued{0};
+  auto const start{Clock::now()};
+  auto const deadline{start + std::chrono::seconds{options.timeout}};
+  auto const before{host::Allocations::now()};
+  // of the process and of its other tasks (all but this thread, which spins between main loops but for --interval)
+  auto const process_before{cpu(CLOCK_PROCESS_CPUTIME_ID)};
+  auto const thread_before{cpu(CLOCK_THREAD_CPUTIME_ID)};
+  while (retired < total && Clock::now() < deadline) {
+    auto const now{Clock::now()};
+    while (enqueued < options.messages &&
+           (options.rate ? now - start >= std::chrono::duration<double>(static_cast<double>(enqueued) / options.rate)
+                         : outstanding.size() < options.window)) {
+      auto const subject{"load " + std::to_string(enqueued)};
+      ++enqueued;
+      // refused, and so retired, at once: it never changes the depth of the queue
+      if (!options.attach && !options.spool.empty() && !esphome::smtp_::Spool::fits(subject, content, "")) {
+        ++refused;
+        ++retired;
+        continue;
+      }
+      outstanding.push_back(Clock::now());
+      if (options.attach) {
+        component.enqueue(subject, produced());
+      } else {
+        component.enqueue(subject, content);
+      }
+    }
+    auto const loop_start{Clock::now()};
+    esphome::App.loop();
+    if (loops.size() < LOOP_SAMPLES) {
+      loops.push_back(static_cast<std::uint32_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - loop_start).count()));
+    }
+    if (options.interval) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{options.interval});
+    }
+  }
+  auto const elapsed{Clock::now() - start};
+  auto const allocations{host::Allocations::now() - before};
+  auto const process_cpu{cpu(CLOCK_PROCESS_CPUTIME_ID) - process_before};
+  auto const tasks_cpu{process_cpu - (cpu(CLOCK_THREAD_CPUTIME_ID) - thread_before)};
+  auto const stacks{host_task_stacks()};
+  esphome::App.teardown(std::chrono::seconds{5});
+
+  dead_letters += refused;  // any not yet published
+  auto const delivered{retired - dead_letters};
+  auto const per_message{[delivered](auto const total) {
+    return static_cast<double>(total) / static_cast<double>(std::max<std::size_t>(delivered, 1));
+  }};
+  auto const seconds{std::chrono::duration<double>(elapsed).count()};
+  auto const rate{static_cast<double>(delivered) / seconds};
+  std::printf("messages %zu delivered %zu dead %zu in %.3f s: %.1f msgs/s (%.0f KB/s of bodies)\n", total, delivered,
+              dead_letters, seconds, rate,
+              rate * static_cast<double>(options.attach ? options.attach : options.size) / 1024);
+  std::printf("delivery latency p50 %.2f ms p99 %.2f ms max %.2f ms\n", percentile(latencies, 0.5),
+              percentile(latencies, 0.99), percentile(latencies, 1.0));
+  std::printf("allocations %.1f per message (%.0f bytes)\n", per_message(allocations.count),
+              per_message(allocations.bytes));
+  std::printf("cpu %.1f us per message, %.1f us of it in other tasks\n", per_message(process_cpu) / 1e3,
+              per_message(tasks_cpu) / 1e3);
+  auto const busy{std::accumulate(loops.begin(), loops.end(), 0.0)};
+  std::printf("main loop p50 %.1f us p99 %.1f us max %.1f us, %.2f ms in all over %zu loops\n",
+              percentile(loops, 0.5) / 1e3, percentile(loops, 0.99) / 1e3, percentile(loops, 1.0) / 1e3, busy / 1e6,
+              loops.size());
+  for (auto const &stack : stacks) {
+    std::printf("task %s stack %u of %u bytes used\n", stack.name.c_str(), stack.used, stack.size);
+  }
+  auto hit_rate{0.0};
+  if (options.connects) {
+    std::lock_guard const lock{connects.mutex};
+    auto const lookups{connects.hits + connects.misses};
+    hit_rate = lookups ? static_cast<double>(connects.hits) / lookups : 0;
+    std::printf("connects %zu: p50 %.2f ms p99 %.2f ms max %.2f ms (resolve p50 %.2f ms max %.2f ms)\n",
+                connects.latencies.size(), percentile(connects.latencies, 0.5),
+                percentile(connects.latencies, 0.99), percentile(connects.latencies, 1.0),
+                percentile(connects.resolves, 0.5), percentile(connects.resolves, 1.0));
+    std::printf("resolve cache %u hits, %u misses: %.1f%% hit rate\n", connects.hits, connects.misses,
+                hit_rate * 100);
+  }
+  auto resumed_rate{0.0};
+  if (options.tls) {
+    std::lock_guard const lock{handshakes.mutex};
+    auto const report{[](char const *const name, Handshakes::Kind const &kind) {
+      auto const n{static_cast<double>(std::max<std::size_t>(kind.latencies.size(), 1))};
+      std::printf("handshakes %s %zu: p50 %.0f ms max %.0f ms, %.0f bytes sent and %.0f received each\n", name,
+                  kind.latencies.size(), percentile(kind.latencies, 0.5), percentile(kind.latencies, 1.0),
+                  static_cast<double>(kind.sent) / n, static_cast<double>(kind.received) / n);
+    }};
+    report("full", handshakes.full);
+    report("resumed", handshakes.resumed);
+    // of those after the first, which had none to resume
+    auto const count{handshakes.full.latencies.size() + handshakes.resumed.latencies.size()};
+    resumed_rate = 1 < count ? static_cast<double>(handshakes.resumed.latencies.size()) / static_cast<double>(count - 1)
+                             : 0;
+  }
+  auto const delivered_all{retired == total && dead_letters <= options.dead};
+  auto const busier{0 < options.max_busy && options.max_busy < busy / 1e6};
+  auto const costlier{0 < options.max_allocations && options.max_allocations < per_message(allocations.count)};
+  auto const missed{options.connects && hit_rate < options.min_hit_rate};
+  auto const misresumed{options.tls && (resumed_rate < options.min_resumed || options.max_resumed < resumed_rate)};
+  return delivered_all && options.min_rate <= rate && !busier && !costlier && !missed && !misresumed ? 0 : 1;
+}
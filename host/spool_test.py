@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Kill smtp_load, with a spool, while it sends to a slow config/smtp_standin.py and check that what it had not sent
+is replayed, and sent, by the next smtp_load: every message is accepted at least once, and at most one
+(that in flight when it was killed) twice. For example
+
+    spool_test.py --config config --load build/smtp_load
+"""
+
+import argparse
+import os
+import pathlib
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--config", type=pathlib.Path, required=True, help="directory of the stand-ins")
+    parser.add_argument("--load", required=True, help="smtp_load executable")
+    parser.add_argument("--messages", type=int, default=50)
+    parser.add_argument("--kill", type=float, default=1, help="seconds after which to kill the first smtp_load")
+    args = parser.parse_args()
+
+    # the stand-in says each reply, and so each message that it accepts
+    standin = subprocess.Popen(
+        [
+            sys.executable,
+            str(args.config / "smtp_standin.py"),
+            "--host",
+            "127.0.0.1",
+            "--port",
+            "0",
+            "--report",
+            "3600",
+            "--latency",
+            "20",
+            "--verbose",
+        ],
+        stdout=subprocess.PIPE,
+        text=True,
+    )
+    accepted = []
+    try:
+        line = standin.stdout.readline()
+        if "listening on" not in line:
+            sys.exit(f"smtp_standin.py did not start: {line!r}")
+        port = int(line.rsplit(":", 1)[1])
+        threading.Thread(
+            target=lambda: accepted.extend(line for line in standin.stdout if "> 250 accepted" in line), daemon=True
+        ).start()
+
+        with tempfile.TemporaryDirectory() as directory:
+            spool = os.path.join(directory, "spool")
+            command = [args.load, "--relay", f"127.0.0.1:{port}", "--spool", spool]
+
+            first = subprocess.Popen(command + ["--messages", str(args.messages), "--window", str(args.messages)])
+            time.sleep(args.kill)
+            first.send_signal(signal.SIGKILL)
+            first.wait()
+            before = len(accepted)
+            print(f"killed after {before} of {args.messages} messages were accepted", flush=True)
+            if not 0 < before < args.messages:
+                print("not killed mid-send: try another --kill", flush=True)
+                return 1
+
+            second = subprocess.run(command + ["--messages", "0"], stdout=subprocess.PIPE, text=True)
+            sys.stdout.write(second.stdout)
+            time.sleep(0.5)  # for the stand-in to say the last of it
+            total = len(accepted)
+            print(f"{total} accepted in all", flush=True)
+            if second.returncode:
+                return second.returncode
+            if not args.messages <= total <= args.messages + 1:
+                print(f"{args.messages} messages were not each accepted once (or one of them twice)", flush=True)
+                return 1
+            return 0
+    finally:
+        standin.send_signal(signal.SIGINT)
+        try:
+            standin.wait(5)
+        except subprocess.TimeoutExpired:
+            standin.kill()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
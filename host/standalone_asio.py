@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Make standalone asio headers from those of Boost.Asio, for a host without standalone asio.
+
+The device builds against Espressif's port of standalone asio. Boost.Asio is the same library,
+but in namespace boost::asio and with boost::system error codes rather than std ones.
+This rewrites a copy of it, as asio's own release tooling does the other way around.
+
+    standalone_asio.py /usr/include build/asio
+"""
+
+import pathlib
+import re
+import shutil
+import sys
+
+
+RVALUE_TOKEN = """
+template <typename CompletionToken, ASIO_COMPLETION_SIGNATURE Signature, typename Initiation, typename... Args>
+inline auto async_initiate(Initiation&& initiation, typename std::remove_reference<CompletionToken>::type&& token,
+    Args&&... args) -> decltype(async_initiate<CompletionToken, Signature>(
+        std::forward<Initiation>(initiation), token, std::forward<Args>(args)...))
+{
+  return async_initiate<CompletionToken, Signature>(
+      std::forward<Initiation>(initiation), token, std::forward<Args>(args)...);
+}
+
+"""
+
+
+def rewrite(text):
+    text = text.replace("boost/asio/", "asio/").replace("<boost/asio.hpp>", "<asio.hpp>")
+    text = text.replace("BOOST_ASIO_", "ASIO_")
+    text = re.sub(r"namespace boost \{\s*namespace asio \{", "namespace asio {", text)
+    text = re.sub(r"\}\s*// namespace asio\s*\}\s*// namespace boost", "} // namespace asio", text)
+    text = re.sub(r"namespace boost \{\s*namespace system \{", "namespace std {", text)
+    text = re.sub(r"\}\s*// namespace system\s*\}\s*// namespace boost", "} // namespace std", text)
+    text = text.replace("boost::asio::", "asio::")
+    text = text.replace("#include <boost/system/error_code.hpp>", "#include <system_error>")
+    text = text.replace("#include <boost/system/system_error.hpp>", "#include <system_error>")
+    text = text.replace("boost::system::", "std::")
+    # defaults of SFINAE pointer parameters, which are in the caller's code for -Wzero-as-null-pointer-constant
+    text = re.sub(r"\*\s*=\s*0(?=\s*[,)])", "* = nullptr", text)
+    return text
+
+
+def main(boost, out):
+    source = pathlib.Path(boost) / "boost"
+    target = pathlib.Path(out)
+    if target.exists():
+        shutil.rmtree(target)
+    # but for asio::ssl, of OpenSSL, which include/asio/ssl stands in for
+    shutil.copytree(source / "asio", target / "asio", ignore=shutil.ignore_patterns("ssl", "ssl.hpp"))
+    shutil.copy(source / "asio.hpp", target / "asio.hpp")
+    for path in [target / "asio.hpp", *(target / "asio").rglob("*")]:
+        if path.is_file():
+            path.write_text(rewrite(path.read_text()))
+    # std::exchange, which standalone asio includes for itself
+    awaitable = target / "asio" / "awaitable.hpp"
+    text = awaitable.read_text()
+    config = "#include <asio/detail/config.hpp>"
+    awaitable.write_text(text.replace(config, config + "\n#include <utility>", 1))
+    # async_initiate of an rvalue completion token, which newer asio accepts
+    async_result = target / "asio" / "async_result.hpp"
+    text = async_result.read_text()
+    end = text.index("#else // defined(ASIO_HAS_VARIADIC_TEMPLATES)", text.index("return completion.result.get();"))
+    async_result.write_text(text[:end] + RVALUE_TOKEN + text[end:])
+
+
+if __name__ == "__main__":
+    main(*sys.argv[1:])
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Run smtp_load (or ping_load) against stand-ins of config/, as a test: it fails if it or any stand-in does.
+
+Each --standin starts a config/smtp_standin.py, with those arguments, on a free port of 127.0.0.1
+and is a relay of smtp_load, in the order given. Each --webhook does the same with the webhook receiver
+of config/notify_standin.py, after them. With none of these, there is one smtp_standin.py. For example
+
+    standin_test.py --config config --load build/smtp_load \\
+        --standin "--latency 5" --standin "--transient 0.1" --load-args "--shard --messages 500"
+
+A --probe starts a config/probe_standin.py instead, whose port is that of the TCP and UDP targets of ping_load.
+
+    standin_test.py --config config --load build/ping_load --probe "--latency 1" --load-args "--target udp:127.0.0.1/20"
+"""
+
+import argparse
+import pathlib
+import shlex
+import signal
+import socket
+import subprocess
+import sys
+import threading
+
+
+def start(command):
+    # a stand-in, and the port it listens on, from the line in which it says so
+    process = subprocess.Popen(command, stdout=subprocess.PIPE, text=True)
+    line = process.stdout.readline()
+    if "listening on" not in line:
+        process.kill()
+        sys.exit(f"{command[1]} did not start: {line!r}")
+    # pass on whatever else it says, as it says it, lest it block on a full pipe
+    threading.Thread(target=lambda: sys.stdout.writelines(process.stdout), daemon=True).start()
+    return process, int(line.rsplit(":", 1)[1])
+
+
+def free_port():
+    # for notify_standin.py, to which 0 is none: another may take it before it does, but not here
+    with socket.socket() as probe:
+        probe.bind(("127.0.0.1", 0))
+        return probe.getsockname()[1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--config", type=pathlib.Path, required=True, help="directory of the stand-ins")
+    parser.add_argument("--load", required=True, help="smtp_load executable")
+    parser.add_argument("--standin", action="append", default=[], help="arguments of an smtp_standin.py relay")
+    parser.add_argument("--webhook", action="append", default=[], help="arguments of a notify_standin.py webhook")
+    parser.add_argument("--probe", action="append", default=[], help="arguments of a probe_standin.py for ping_load")
+    parser.add_argument("--load-args", default="", help="arguments of smtp_load")
+    args = parser.parse_args()
+
+    standins = []
+    relays = []
+    try:
+        for arguments in args.standin or ([] if args.webhook or args.probe else [""]):
+            process, port = start(
+                [
+                    sys.executable,
+                    str(args.config / "smtp_standin.py"),
+                    "--host",
+                    "127.0.0.1",
+                    "--port",
+                    "0",
+                    "--report",
+                    "3600",
+                    *shlex.split(arguments),
+                ]
+            )
+            standins.append(process)
+            relays += ["--relay", f"127.0.0.1:{port}"]
+        for arguments in args.webhook:
+            process, port = start(
+                [
+                    sys.executable,
+                    str(args.config / "notify_standin.py"),
+                    "--host",
+                    "127.0.0.1",
+                    "--syslog-port",
+                    "0",
+                    "--mqtt-port",
+                    "0",
+                    "--webhook-port",
+                    str(free_port()),
+                    "--report",
+                    "3600",
+                    *shlex.split(arguments),
+                ]
+            )
+            standins.append(process)
+            relays += ["--relay", f"127.0.0.1:{port}/webhook/smtp_"]
+        for arguments in args.probe:
+            process, port = start(
+                [
+                    sys.executable,
+                    str(args.config / "probe_standin.py"),
+                    "--host",
+                    "127.0.0.1",
+                    "--port",
+                    "0",
+                    "--report",
+                    "3600",
+                    *shlex.split(arguments),
+                ]
+            )
+            standins.append(process)
+            relays += ["--port", str(port)]
+        command = [args.load, *relays, *shlex.split(args.load_args)]
+        print(" ".join(command), flush=True)
+        status = subprocess.run(command).returncode
+    finally:
+        for process in standins:
+            process.send_signal(signal.SIGINT)
+        for process in standins:
+            try:
+                process.wait(5)
+            except subprocess.TimeoutExpired:
+                process.kill()
+    for process in standins:
+        if process.returncode:
+            print(f"{process.args[1]} failed", flush=True)
+            status = status or process.returncode
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())